@@ -0,0 +1,351 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+//  throughput, latency and allocations of every DBHelper operation against a fresh database in the temp directory,
+//  operations that have a raw SQLiteCpp equivalent are run a second time through a statement prepared once,
+//  the difference is what the wrapper costs
+//  usage: db_helper_bench [rows] [iterations]
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include "../include/DBHelper.h"
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct BenchRow {
+    int64_t id;
+    std::string name;
+    int64_t score;
+};
+
+DBHELPER_ROW(BenchRow, id, name, score)
+
+struct result {
+    std::string name;
+    double ops_per_sec;
+    double p50_ns;
+    double p99_ns;
+    double allocations_per_op;
+};
+
+static std::vector<result> results;
+
+//  times every call of f separately, the clock and the counter are read outside of it
+template<typename F>
+static const result &run(const std::string &name, size_t iterations, F &&f) {
+    std::vector<double> latencies(iterations);
+    size_t allocated = 0;
+    double total = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        size_t allocations_before = allocations.load(std::memory_order_relaxed);
+        auto begin = std::chrono::steady_clock::now();
+        f(i);
+        auto end = std::chrono::steady_clock::now();
+        allocated += allocations.load(std::memory_order_relaxed) - allocations_before;
+
+        latencies[i] = std::chrono::duration<double, std::nano>(end - begin).count();
+        total += latencies[i];
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    results.push_back({name,
+                       static_cast<double>(iterations) / (total / 1e9),
+                       latencies[iterations / 2],
+                       latencies[std::min(iterations - 1, iterations * 99 / 100)],
+                       static_cast<double>(allocated) / static_cast<double>(iterations)});
+
+    const result &r = results.back();
+    std::cout << std::left << std::setw(40) << r.name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << r.ops_per_sec << " ops/s"
+              << std::setw(10) << r.p50_ns << " ns p50"
+              << std::setw(10) << r.p99_ns << " ns p99"
+              << std::setprecision(1) << std::setw(8) << r.allocations_per_op << " allocs/op\n";
+    return r;
+}
+
+static void overhead(const result &wrapped, const result &raw) {
+    std::cout << std::left << std::setw(40) << wrapped.name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(12) << wrapped.p50_ns - raw.p50_ns << " ns p50 more"
+              << std::setprecision(2) << std::setw(10) << wrapped.p50_ns / raw.p50_ns << "x"
+              << std::setprecision(1) << std::setw(10) << wrapped.allocations_per_op - raw.allocations_per_op
+              << " allocs/op\n";
+}
+
+int main(int argc, char **argv) {
+    const size_t rows = argc > 1 ? std::stoul(argv[1]) : 10000;
+    const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 10000;
+    //  full table scans grow with the table, keep their total time close to the point lookups
+    const size_t scan_iterations = std::max<size_t>(10, iterations * 100 / std::max<size_t>(rows, 100));
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "db_helper_bench";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string path = (dir / "bench.db3").string();
+
+    std::cout << "rows: " << rows << ", iterations: " << iterations << ", database: " << path << "\n\n";
+    {
+        DBHelper db_helper(path, DBHelper::options::of(DBHelper::BALANCED));
+        SQLite::Database &raw = db_helper.db();
+
+        run("create", std::min<size_t>(iterations, 1000), [&](size_t i) {
+            db_helper.create("create_" + std::to_string(i),
+                             "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+        });
+        for (size_t i = 0; i < std::min<size_t>(iterations, 1000); ++i)
+            db_helper.drop("create_" + std::to_string(i));
+
+        db_helper.create("bench", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                         "score", DBHelper::INTEGER);
+        db_helper.create("raw", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                         "score", DBHelper::INTEGER);
+        std::vector<std::tuple<int64_t, std::string, int64_t>> initial;
+        for (size_t i = 0; i < rows; ++i)
+            initial.emplace_back(i, "name" + std::to_string(i), i % 100);
+        db_helper.insert_many("bench", {"id", "name", "score"}, initial);
+        db_helper.insert_many("raw", {"id", "name", "score"}, initial);
+
+        //  every insert benchmark adds its own id range past the initial rows
+        int64_t next_id = static_cast<int64_t>(rows);
+        auto id = [&](size_t i) { return next_id + static_cast<int64_t>(i); };
+        const std::string name = "name";
+
+        result insert_variadic = run("insert(table, columns..., values...)", iterations, [&](size_t i) {
+            db_helper.insert("bench", "id", "name", "score", id(i), name, 1);
+        });
+        SQLite::Statement raw_insert(raw, "INSERT INTO raw (id, name, score) VALUES (?, ?, ?)");
+        result insert_raw = run("raw insert", iterations, [&](size_t i) {
+            raw_insert.bind(1, static_cast<int64_t>(id(i)));
+            raw_insert.bind(2, name);
+            raw_insert.bind(3, 1);
+            raw_insert.exec();
+            raw_insert.reset();
+        });
+        next_id += static_cast<int64_t>(iterations);
+
+        run("insert(table, {columns}, values...)", iterations, [&](size_t i) {
+            db_helper.insert("bench", {"id", "name", "score"}, id(i), name, 1);
+        });
+        next_id += static_cast<int64_t>(iterations);
+
+        run("insert(table, vector<pair>)", iterations, [&](size_t i) {
+            db_helper.insert("bench", std::vector<std::pair<std::string, int64_t>>{
+                    {"id", id(i)}, {"score", 1}});
+        });
+        next_id += static_cast<int64_t>(iterations);
+
+        run("insert(table, Row)", iterations, [&](size_t i) {
+            db_helper.insert("bench", BenchRow{id(i), name, 1});
+        });
+        next_id += static_cast<int64_t>(iterations);
+
+        std::vector<BenchRow> batch(100);
+        run("insert_many(table, rows) x100", std::max<size_t>(1, iterations / 100), [&](size_t i) {
+            for (size_t j = 0; j < batch.size(); ++j)
+                batch[j] = {id(i * batch.size() + j), name, 1};
+            db_helper.insert_many("bench", batch);
+        });
+        next_id += static_cast<int64_t>(std::max<size_t>(1, iterations / 100) * batch.size());
+
+        auto key = [&](size_t i) { return static_cast<int64_t>(i % rows); };
+
+        result get_by_key = run("get(table, column, value)", iterations, [&](size_t i) {
+            db_helper.get("bench", "id", key(i)).getInt64();
+        });
+        SQLite::Statement raw_get(raw, "SELECT * FROM raw WHERE id=?");
+        result get_raw = run("raw get", iterations, [&](size_t i) {
+            raw_get.bind(1, static_cast<int64_t>(key(i)));
+            raw_get.executeStep();
+            raw_get.getColumn(0).getInt64();
+            raw_get.reset();
+        });
+
+        run("get(table, column, cond_column, value)", iterations, [&](size_t i) {
+            db_helper.get("bench", "name", "id", key(i)).getText();
+        });
+        run("get(table, column, tuple)", iterations, [&](size_t i) {
+            db_helper.get("bench", "name", std::make_tuple("id", "=", key(i))).getText();
+        });
+        run("get(table, column, vector<tuple>)", iterations, [&](size_t i) {
+            db_helper.get("bench", "name", std::vector<std::tuple<std::string, std::string, int64_t>>{
+                    {"id", "=", key(i)}, {"score", ">=", 0}}).getText();
+        });
+
+        auto drain = [](const std::shared_ptr<SQLite::Statement> &query) {
+            while (query && query->executeStep());
+        };
+        run("select(table)", scan_iterations, [&](size_t) { drain(db_helper.select("bench")); });
+        run("select(table, column)", scan_iterations, [&](size_t) { drain(db_helper.select("bench", "name")); });
+        run("select(table, {columns})", scan_iterations, [&](size_t) {
+            drain(db_helper.select("bench", {"id", "name"}));
+        });
+
+        result select_tuple = run("select(table, tuple)", iterations, [&](size_t i) {
+            drain(db_helper.select("bench", std::make_tuple("id", "=", key(i))));
+        });
+        SQLite::Statement raw_select(raw, "SELECT * FROM raw WHERE id=?");
+        result select_raw = run("raw select", iterations, [&](size_t i) {
+            raw_select.bind(1, static_cast<int64_t>(key(i)));
+            while (raw_select.executeStep());
+            raw_select.reset();
+        });
+
+        run("select(table, tuple, columns...)", iterations, [&](size_t i) {
+            drain(db_helper.select("bench", std::make_tuple("id", "=", key(i)), "id", "name"));
+        });
+        run("select(table, {columns}, tuple)", iterations, [&](size_t i) {
+            drain(db_helper.select("bench", {"id", "name"}, std::make_tuple("id", "=", key(i))));
+        });
+        run("select(table, vector<tuple>)", iterations, [&](size_t i) {
+            drain(db_helper.select("bench", std::vector<std::tuple<std::string, std::string, int64_t>>{
+                    {"id", "=", key(i)}, {"score", ">=", 0}}));
+        });
+        run("select<Row>(table, tuple)", iterations, [&](size_t i) {
+            db_helper.select<BenchRow>("bench", std::make_tuple("id", "=", key(i)));
+        });
+
+        result update_by_key = run("update(table, column, value, ...)", iterations, [&](size_t i) {
+            db_helper.update("bench", "id", key(i), "score", static_cast<int64_t>(i));
+        });
+        SQLite::Statement raw_update(raw, "UPDATE raw SET score=? WHERE id=?");
+        result update_raw = run("raw update", iterations, [&](size_t i) {
+            raw_update.bind(1, static_cast<int64_t>(i));
+            raw_update.bind(2, static_cast<int64_t>(key(i)));
+            raw_update.exec();
+            raw_update.reset();
+        });
+        run("update(table, tuple, ...)", iterations, [&](size_t i) {
+            db_helper.update("bench", std::make_tuple("id", "=", key(i)), "score", static_cast<int64_t>(i));
+        });
+
+        result exists_key = run("exists(table, column, value)", iterations, [&](size_t i) {
+            db_helper.exists("bench", "id", static_cast<int64_t>(i % (2 * rows)));
+        });
+        SQLite::Statement raw_exists(raw, "SELECT EXISTS(SELECT 1 FROM raw WHERE id=? LIMIT 1)");
+        result exists_raw = run("raw exists", iterations, [&](size_t i) {
+            raw_exists.bind(1, static_cast<int64_t>(i % (2 * rows)));
+            raw_exists.executeStep();
+            raw_exists.getColumn(0).getInt();
+            raw_exists.reset();
+        });
+        db_helper.enable_bloom_filter("bench", "id", rows * 2);
+        run("exists(...) with bloom filter", iterations, [&](size_t i) {
+            db_helper.exists("bench", "id", static_cast<int64_t>(i % (2 * rows)));
+        });
+        db_helper.disable_bloom_filter("bench", "id");
+
+        run("table_empty(table)", iterations, [&](size_t) { db_helper.table_empty("bench"); });
+        run("table_exists(table)", iterations, [&](size_t) { db_helper.table_exists("bench"); });
+        run("column_index(table, column)", iterations, [&](size_t) { db_helper.column_index("bench", "score"); });
+
+        //  shared keeps the connection open, short lived DBHelpers of this thread share it
+        std::unique_ptr<DBHelper> shared = DBHelper::shared(path);
+        run("DBHelper::shared(path)->exists(...)", std::min<size_t>(iterations, 1000), [&](size_t i) {
+            DBHelper::shared(path)->exists("bench", "id", key(i));
+        });
+        run("DBHelper(path).exists(...)", std::min<size_t>(iterations, 1000), [&](size_t i) {
+            DBHelper(path).exists("bench", "id", key(i));
+        });
+
+        db_helper.create("small", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+        for (int i = 0; i < 10; ++i)
+            db_helper.insert("small", "id", "name", i, name);
+        //  the rows go nowhere, only formatting and stepping are measured
+        std::ostream null_stream(nullptr);
+        run("write_to_cli(table) 10 rows", std::min<size_t>(iterations, 1000), [&](size_t) {
+            std::streambuf *cout_buffer = std::cout.rdbuf(null_stream.rdbuf());
+            db_helper.write_to_cli("small");
+            std::cout.rdbuf(cout_buffer);
+        });
+
+        int null_fd = open("/dev/null", O_WRONLY);
+        //  the whole table per call, rows/s is ops/s times the row count
+        for (auto [format, label]: {std::pair(DBHelper::CSV, "CSV"), std::pair(DBHelper::JSON_LINES, "JSON Lines"),
+                                    std::pair(DBHelper::BINARY, "binary")})
+            run(std::string("export_table(table) ") + label, scan_iterations, [&, format = format](size_t) {
+                db_helper.export_table("bench", null_fd, format);
+            });
+        close(null_fd);
+
+        //  round trip of the table through a CSV and a JSON Lines file
+        for (auto [format, label]: {std::pair(DBHelper::CSV, "CSV"), std::pair(DBHelper::JSON_LINES, "JSON Lines")}) {
+            const std::string dump = (dir / "bench.dump").string();
+            int dump_fd = open(dump.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            db_helper.export_table("bench", dump_fd, format);
+            close(dump_fd);
+
+            db_helper.create("imported", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                             "score", DBHelper::INTEGER);
+            DBHelper::import_options opts;
+            opts.format = format;
+            DBHelper::import_stats stats = db_helper.import_file("imported", dump, opts);
+            std::cout << std::left << std::setw(40) << std::string("import_file(table, path) ") + label
+                      << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(12) << stats.rows_per_second() << " rows/s"
+                      << std::setprecision(1) << std::setw(10) << stats.bytes_per_second() / 1e6 << " MB/s\n";
+            db_helper.drop("imported");
+        }
+
+        const std::string backup = (dir / "backup.db3").string();
+        run("backup_to(path, 1024 pages, no pause)", 10, [&](size_t) {
+            db_helper.backup_to(backup, 1024, std::chrono::milliseconds(0)).get();
+        });
+        run("snapshot_to_memory()", 10, [&](size_t) { db_helper.snapshot_to_memory(); });
+        run("load_from_file(path) into :memory:", 10, [&](size_t) { DBHelper(":memory:").load_from_file(backup); });
+        DBHelper memory(":memory:");
+        memory.load_from_file(backup);
+        run("save_to_file(path) from :memory:", 10, [&](size_t) { memory.save_to_file(backup); });
+
+        //  deletes the rows the insert benchmarks added, one id per call
+        result dele_by_key = run("dele(table, column, value)", iterations, [&](size_t i) {
+            db_helper.dele("bench", "id", static_cast<int64_t>(rows + i));
+        });
+        SQLite::Statement raw_delete(raw, "DELETE FROM raw WHERE id=?");
+        result dele_raw = run("raw dele", iterations, [&](size_t i) {
+            raw_delete.bind(1, static_cast<int64_t>(rows + i));
+            raw_delete.exec();
+            raw_delete.reset();
+        });
+        run("dele(table, column, op, value)", iterations, [&](size_t i) {
+            db_helper.dele("bench", "id", "=", static_cast<int64_t>(rows + iterations + i));
+        });
+        run("dele(table, tuple)", iterations, [&](size_t i) {
+            db_helper.dele("bench", std::make_tuple("id", "=", static_cast<int64_t>(rows + 2 * iterations + i)));
+        });
+
+        std::cout << "\nDBHelper versus raw SQLiteCpp with the statement prepared once:\n";
+        overhead(insert_variadic, insert_raw);
+        overhead(get_by_key, get_raw);
+        overhead(select_tuple, select_raw);
+        overhead(update_by_key, update_raw);
+        overhead(exists_key, exists_raw);
+        overhead(dele_by_key, dele_raw);
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
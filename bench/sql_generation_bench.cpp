@@ -0,0 +1,59 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+//  per call cost of generating the sql of the variadic insert/update templates,
+//  "runtime" formats it on every call like DBHelper used to, "cached" is the current path
+//  usage: sql_generation_bench [iterations]
+
+#include <chrono>
+#include <string>
+#include <iostream>
+
+#define DBHELPER_TESTING_MODE
+#include "../include/DBHelper.h"
+
+template<typename F>
+static void run(const std::string &name, size_t iterations, F &&f) {
+    size_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += f();
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(iterations);
+    std::cout << name << ": " << ns << " ns/call (" << sink % 10 << ")\n";
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::string table_name = "users", id = "id", name = "name", email = "email";
+
+    run("insert runtime", iterations, [&] {
+        std::string sql = mutl::concatenate(
+                "INSERT INTO ", table_name,
+                " (", mutl::format_with_comma<0, 2>(id, name, email, 1, "a", "b"),
+                ") VALUES (", DBHelper::intersected_questionmarks(3), ")");
+        return sql.size();
+    });
+
+    run("insert cached ", iterations, [&] {
+        return DBHelper::insert_sql(table_name, id, name, email, 1, "a", "b").size();
+    });
+
+    typename integer_range_generate<std::size_t, 0, 2, 2>::type columns;
+    run("update runtime", iterations, [&] {
+        std::string sql = mutl::concatenate(
+                "UPDATE ", table_name,
+                " SET ", DBHelper::format_into_question_mark_equation_comma(columns, std::forward_as_tuple(
+                        name, "a", email, "b")),
+                " WHERE ", id, "=?");
+        return sql.size();
+    });
+
+    run("update cached ", iterations, [&] {
+        return DBHelper::update_sql(table_name, columns, std::forward_as_tuple(name, "a", email, "b"), id, "=").size();
+    });
+
+    return 0;
+}
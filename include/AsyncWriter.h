@@ -0,0 +1,131 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "DBHelper.h"
+
+/**
+ * @brief write-behind queue for one database file\n
+ * insert/update/dele calls return right away, a background thread with its own connection drains them in batches and
+ * commits every batch in one transaction, so one fsync covers a whole batch instead of every write
+ * @example
+ * @code
+ * AsyncWriter writer("/home/username/.local/share/ProjectName/database.db3");
+ *
+ * //  from any thread
+ * std::future<bool> written = writer.insert("table_name", "id", "val", 1, "a");
+ * ...
+ * if (!written.get())
+ *     //  the insert failed or its batch couldn't be committed
+ * @endcode
+ */
+class AsyncWriter {
+public:
+    struct batching {
+        /// writes committed together at most
+        size_t max_batch_size = 512;
+        /// how long the first write of a batch waits for others to join before the batch is committed
+        std::chrono::microseconds max_latency{2000};
+    };
+
+    struct writer_stats {
+        size_t writes = 0;
+        size_t batches = 0;
+        size_t failed_commits = 0;
+    };
+
+private:
+    /// node of the queue, <b>work</b> returns false if the write failed
+    struct request {
+        std::atomic<request *> next{nullptr};
+        std::function<bool(DBHelper &)> work;
+        std::promise<bool> done;
+    };
+
+    std::unique_ptr<DBHelper> db_helper;
+    batching limits;
+
+    //  intrusive multi producer single consumer queue after Dmitry Vyukov, producers exchange head,
+    //  only the writer thread touches tail
+    std::atomic<request *> head;
+    request *tail;
+    request stub;
+    /// pushed but not yet popped, lets the writer thread sleep on an empty queue
+    std::atomic<size_t> pending{0};
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopping{false};
+
+    /// only written by the writer thread, read under <b>mutex</b>
+    writer_stats stats;
+
+    std::thread worker;
+
+public:
+    /// @param db_path the complete path to the database @example /home/username/.local/share/ProjectName/database.db3
+    explicit AsyncWriter(const std::string &db_path);
+
+    /**
+     * @param db_path the complete path to the database @example /home/username/.local/share/ProjectName/database.db3
+     * @param opts applied to the writer's connection
+     */
+    AsyncWriter(const std::string &db_path, batching limits,
+                const DBHelper::options &opts = DBHelper::options::of(DBHelper::BALANCED));
+
+    /// commits everything queued so far and stops the writer thread
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter &) = delete;
+
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    /// @see DBHelper::insert
+    template<typename ...Args>
+    inline std::future<bool> insert(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::update
+    template<typename ...Args>
+    inline std::future<bool> update(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::dele
+    template<typename ...Args>
+    inline std::future<bool> dele(const std::string &table_name, Args &&...args);
+
+    /**
+     * @brief queues any write, <b>work</b> runs on the writer thread inside the batch's transaction
+     * @param work returns false if the write failed, exceptions are passed on through the future
+     */
+    std::future<bool> execute(std::function<bool(DBHelper &)> work);
+
+    /// @return future that is ready once every write queued before it is committed
+    std::future<bool> flush();
+
+    writer_stats get_stats();
+
+private:
+    /// wraps <b>args</b> into a work item that owns copies of them, pointers to text are copied into strings
+    template<typename ...Args>
+    static inline auto own(Args &&...args);
+
+    void push(request *r);
+
+    /// @return nullptr if the queue is empty or a producer is halfway through push()
+    request *pop();
+
+    void run();
+
+    void commit(std::vector<request *> &batch);
+};
+
+#include "AsyncWriter.inl"
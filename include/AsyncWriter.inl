@@ -0,0 +1,47 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+
+template<typename ...Args>
+inline auto AsyncWriter::own(Args &&...args) {
+    //  the caller's buffers are gone by the time the writer thread gets to the request
+    auto owned = [](auto &&arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *> ||
+                      std::is_same_v<T, std::string_view>)
+            return std::string(arg);
+        else
+            return T(std::forward<decltype(arg)>(arg));
+    };
+    return std::make_tuple(owned(std::forward<Args>(args))...);
+}
+
+template<typename ...Args>
+inline std::future<bool> AsyncWriter::insert(const std::string &table_name, Args &&...args) {
+    return execute([table_name, args = own(std::forward<Args>(args)...)](DBHelper &db_helper) mutable {
+        return std::apply([&](auto &...values) {
+            return !db_helper.insert(table_name, values...).empty();
+        }, args);
+    });
+}
+
+template<typename ...Args>
+inline std::future<bool> AsyncWriter::update(const std::string &table_name, Args &&...args) {
+    return execute([table_name, args = own(std::forward<Args>(args)...)](DBHelper &db_helper) mutable {
+        return std::apply([&](auto &...values) {
+            return !db_helper.update(table_name, values...).empty();
+        }, args);
+    });
+}
+
+template<typename ...Args>
+inline std::future<bool> AsyncWriter::dele(const std::string &table_name, Args &&...args) {
+    return execute([table_name, args = own(std::forward<Args>(args)...)](DBHelper &db_helper) mutable {
+        return std::apply([&](auto &...values) {
+            return !db_helper.dele(table_name, values...).empty();
+        }, args);
+    });
+}
@@ -0,0 +1,44 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief probabilistic set of strings, might_contain() never returns false for an added value but may return true for
+ * values that were never added with roughly the false positive rate it was sized for
+ */
+class BloomFilter {
+    std::vector<uint64_t> bits;
+    size_t bit_count;
+    int hash_count;
+    size_t value_count = 0;
+
+public:
+    /**
+     * @param expected_values amount of values the filter is sized for
+     * @param false_positive_rate probability of might_contain() returning true for a value that wasn't added while
+     * at most <b>expected_values</b> values were added
+     */
+    explicit BloomFilter(size_t expected_values = 1024, double false_positive_rate = 0.01);
+
+    void add(std::string_view value);
+
+    bool might_contain(std::string_view value) const;
+
+    void clear();
+
+    /// amount of add() calls, duplicates included
+    inline size_t size() const { return value_count; }
+
+    /// size of the bit array in bytes
+    inline size_t memory_usage() const { return bits.size() * sizeof(uint64_t); }
+
+private:
+    static uint64_t mix(uint64_t hash);
+};
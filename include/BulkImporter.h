@@ -0,0 +1,142 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "DBHelper.h"
+
+/**
+ * @brief memory maps a CSV or JSON Lines file and parses it in chunks on several threads, the values are converted
+ * by the affinity of the column they go to the way sqlite would convert them\n
+ * used by DBHelper::import_file, which writes the parsed chunks
+ * @warning CSV quotes are only recognized at the start of a field, a quote inside an unquoted field throws off
+ * where the chunks are split, a chunk whose first row is rejected has the rest of the file parsed again on one
+ * thread
+ */
+class BulkImporter {
+public:
+    /// sqlite column affinity, see https://www.sqlite.org/datatype3.html#determination_of_column_affinity
+    enum affinity {
+        INTEGER,
+        REAL,
+        NUMERIC,
+        TEXT,
+        BLOB,
+    };
+
+    enum value_type {
+        NULL_VALUE,
+        INTEGER_VALUE,
+        REAL_VALUE,
+        TEXT_VALUE,
+    };
+
+    struct value {
+        value_type type = NULL_VALUE;
+        int64_t integer = 0;
+        double real = 0;
+        /// offset of the null terminated text in chunk::text
+        size_t text = 0;
+    };
+
+    /// column the parsed values go to
+    struct target {
+        std::string name;
+        affinity type;
+    };
+
+    /// rows of one part of the file, get_targets().size() values per row
+    struct chunk {
+        std::vector<value> values;
+        /// the text values one after another, each null terminated
+        std::string text;
+        size_t rows = 0;
+        /// rows skipped because they were malformed or had the wrong amount of fields
+        size_t rejected = 0;
+        /// size of the part of the file
+        size_t bytes = 0;
+        /// the first row was rejected, for CSV the sign of a part that doesn't start where a row does
+        bool first_row_rejected = false;
+
+        inline const char *text_of(const value &v) const { return text.data() + v.text; }
+    };
+
+private:
+    int fd = -1;
+    const char *data = nullptr;
+    size_t size = 0;
+    /// first byte after the byte order mark and the CSV header
+    const char *body = nullptr;
+
+    DBHelper::export_format input_format;
+    char delimiter;
+    size_t chunk_bytes;
+
+    std::vector<std::string> header;
+    std::vector<target> targets;
+    /// target of every CSV field, -1 if the field is skipped
+    std::vector<int> field_targets;
+
+public:
+    /**
+     * @param input_format DBHelper::CSV or DBHelper::JSON_LINES
+     * @param header the first CSV line names the fields, ignored for JSON Lines
+     * @param chunk_bytes roughly the size of the parts parsed by one thread at a time
+     * @throws std::system_error if the file can't be opened or mapped
+     * @throws std::invalid_argument for DBHelper::BINARY
+     */
+    BulkImporter(const std::string &path, DBHelper::export_format input_format, char delimiter = ',', bool header = true,
+                 size_t chunk_bytes = 4 << 20);
+
+    ~BulkImporter();
+
+    BulkImporter(const BulkImporter &) = delete;
+
+    BulkImporter &operator=(const BulkImporter &) = delete;
+
+    /// size of the file in bytes
+    inline size_t get_size() const { return size; }
+
+    /// names read from the CSV header, empty without one
+    inline const std::vector<std::string> &get_header() const { return header; }
+
+    /**
+     * @brief picks the columns the values go to, CSV fields are matched to <b>columns</b> by header name or by
+     * position without a header and fields without a column are skipped, JSON keys are matched by name\n
+     * names are compared case insensitively like sqlite does
+     */
+    void set_targets(const std::vector<target> &columns);
+
+    /// the columns picked by set_targets() in the order of the values of a row
+    inline const std::vector<target> &get_targets() const { return targets; }
+
+    /**
+     * @brief parses the file on <b>threads</b> threads and hands the chunks to <b>consume</b> in file order on the
+     * calling thread, at most two chunks per thread are held at a time
+     * @param consume returns false to stop the import
+     */
+    void run(size_t threads, const std::function<bool(chunk &)> &consume) const;
+
+    /// @return the affinity sqlite gives a column declared with <b>declared_type</b>
+    static affinity affinity_of(const std::string &declared_type);
+
+private:
+    /// @return start of every chunk followed by the end of the file, every start is the start of a row
+    std::vector<const char *> split(size_t threads) const;
+
+    /// parses the rows starting before <b>stop</b>, @return the end of the last one
+    const char *parse_csv(const char *begin, const char *end, const char *stop, chunk &out) const;
+
+    void parse_json_lines(const char *begin, const char *end, chunk &out) const;
+
+    /// converts a field by the affinity of its column, <b>quoted</b> values are never NULL
+    static value convert(std::string_view raw, bool quoted, affinity type, chunk &out);
+};
@@ -6,6 +6,21 @@
 
 #include <vector>
 #include <iostream>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <algorithm>
+#include <tuple>
+#include <array>
+#include <optional>
+#include <any>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
 
 #include <SQLiteCpp/Column.h>
 #include <SQLiteCpp/VariadicBind.h>
@@ -14,6 +29,9 @@
 #include <my_utils/StringUtils.h>
 #include <my_utils/ArgumentUtils.h>
 
+#include "DBRow.h"
+#include "BloomFilter.h"
+
 #ifdef DBHELPER_TESTING_MODE
 #define private public
 #endif
@@ -22,10 +40,55 @@ namespace SQLite {
     class Database;
 }
 
+struct sqlite3_stmt;
+
 //TODO: exception handling
 //TODO: add && in arg bundles
 class DBHelper {
-    SQLite::Database *database;
+private:
+    /// Bloom filter over the values of one column, see DBHelper::enable_bloom_filter
+    struct column_filter {
+        BloomFilter filter;
+        size_t expected_values;
+        double false_positive_rate;
+        /// INTEGER affinity columns convert numeric text before comparing, only integer keys can be trusted
+        bool integer_affinity;
+        /// lower case name of the table, update_hook reports the tables written as declared
+        std::string table;
+        bool populated = false;
+        /// rows update_hook saw inserted or updated since the filter was filled, read into it on the next exists()
+        std::vector<int64_t> written_rowids;
+        /// PRAGMA data_version when the filter was filled, it changes once another connection commits
+        int64_t data_version = -1;
+        /// sqlite3_total_changes64 and connection::hooked_changes when the filter was filled, rows written without
+        /// the hook being called (WITHOUT ROWID tables, DELETE without WHERE) make them drift apart
+        int64_t checked_total_changes = 0;
+        int64_t checked_hooked_changes = 0;
+    };
+
+    /**
+     * @brief an open database and the state sqlite keeps per connection, owned by one DBHelper or shared by the
+     * DBHelpers DBHelper::shared opened on the same file on the same thread
+     */
+    struct connection {
+        std::unique_ptr<SQLite::Database> database;
+        /// DBHelpers using the connection, the trace and hook callbacks are passed on to each of them
+        std::vector<DBHelper *> helpers;
+        /// number of savepoints currently open through DBHelper::Savepoint guards
+        int savepoint_depth = 0;
+        /// rows written as counted by update_hook, compared against sqlite3_total_changes64 to notice writes the hook
+        /// isn't called for (WITHOUT ROWID tables, DELETE without WHERE)
+        int64_t hooked_changes = 0;
+        /// Bloom filters kept for every DBHelper on the connection, keyed by table_name.column
+        std::unordered_map<std::string, column_filter> bloom_filters;
+        /// PRAGMA data_version, read before a Bloom filter is trusted to report a value missing
+        std::unique_ptr<SQLite::Statement> data_version_query;
+
+        ~connection();
+    };
+    std::shared_ptr<connection> db_connection;
+    /// <b>db_connection->database</b>, nullptr if the database couldn't be opened
+    SQLite::Database *database = nullptr;
 
     /// the name of the created database with extension @example database.db3
     std::string db_name;
@@ -37,6 +100,247 @@ class DBHelper {
     //  TODO: add support for project wide database path initialization
     inline static std::string default_path;
 
+    /// prepared statements keyed by their sql, most recently used at the front
+    std::list<std::pair<std::string, std::shared_ptr<SQLite::Statement>>> statement_cache;
+    /// lookup into statement_cache, keys view the sql strings stored in the list
+    std::unordered_map<std::string_view, decltype(statement_cache)::iterator> statement_cache_index;
+    size_t statement_cache_capacity = 64;
+
+public:
+    struct statement_cache_stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    /// what one sql text cost since instrumentation was enabled, see DBHelper::enable_instrumentation
+    struct query_stats {
+        /// completed executions, a statement stepped to its end or reset midway
+        size_t calls = 0;
+        /// rows returned by queries, rows changed by INSERT/UPDATE/DELETE
+        size_t rows = 0;
+        uint64_t prepare_ns = 0;
+        uint64_t step_ns = 0;
+        /// executions by duration, bucket i holds [2^i, 2^(i+1)) microseconds, the first also everything faster
+        std::array<size_t, 24> histogram{};
+
+        /// @return upper bound of the histogram bucket holding the <b>percentile</b> (0-1) execution
+        uint64_t percentile_us(double percentile) const;
+    };
+
+    enum dump_format {
+        PLAIN_TEXT,
+        JSON,
+    };
+
+    /// one execution that ran longer than the slow query threshold, see DBHelper::set_slow_query_log
+    struct slow_query {
+        /// the sql as prepared
+        std::string sql;
+        /// the sql with the bound values written in place of the parameters
+        std::string expanded_sql;
+        std::chrono::nanoseconds elapsed;
+        /// rows stepped through by full table scans
+        int fullscan_steps;
+        /// sort operations, each one is an ORDER BY or GROUP BY no index could serve
+        int sorts;
+        /// rows inserted into automatic indexes built for this execution
+        int autoindex_rows;
+        int vm_steps;
+        /// EXPLAIN QUERY PLAN output, one indented line per step
+        std::string plan;
+    };
+
+    using slow_query_sink = std::function<void(const slow_query &)>;
+
+    /**
+     * @brief layouts written by DBHelper::export_rows\n
+     * CSV: RFC 4180 with a header line, NULL as an empty field, empty text as "", blobs as hex\n
+     * JSON_LINES: one object per row keyed by column name, blobs as hex strings\n
+     * BINARY: "DBHX", u32 column count, u32 length + name of every column, then every value as a type byte
+     * (1 integer, 2 float, 3 text, 4 blob, 5 null) followed by an i64, an f64 or a u32 length + bytes,
+     * integers little endian
+     */
+    enum export_format {
+        CSV,
+        JSON_LINES,
+        BINARY,
+    };
+
+    /// see DBHelper::import_file
+    struct import_options {
+        /// CSV or JSON_LINES
+        export_format format = CSV;
+        char delimiter = ',';
+        /// the first CSV line names the columns, without it the fields are in the order of the table's columns
+        bool header = true;
+        /// parser threads, 0 starts one per core
+        size_t threads = 0;
+        /// roughly how much of the file one parser thread takes at a time
+        size_t chunk_bytes = 4 << 20;
+        /// rows committed together
+        size_t rows_per_transaction = 1 << 20;
+        /// synchronous, cache size, mmap size and temp store of the BULK_LOAD profile for the import, restored after
+        bool bulk_load = true;
+    };
+
+    struct import_stats {
+        /// rows inserted
+        size_t rows = 0;
+        /// rows skipped because they were malformed or had the wrong amount of fields
+        size_t rejected_rows = 0;
+        /// bytes of the file parsed
+        size_t bytes = 0;
+        std::chrono::nanoseconds elapsed{0};
+        /// false if the file couldn't be read or an insert failed
+        bool completed = false;
+
+        inline double rows_per_second() const {
+            return elapsed.count() ? static_cast<double>(rows) * 1e9 / static_cast<double>(elapsed.count()) : 0;
+        }
+
+        inline double bytes_per_second() const {
+            return elapsed.count() ? static_cast<double>(bytes) * 1e9 / static_cast<double>(elapsed.count()) : 0;
+        }
+    };
+
+    /// see DBHelper::backup_to
+    struct backup_progress {
+        /// pages still to copy
+        int remaining_pages = 0;
+        /// pages of the source when the last step ran
+        int total_pages = 0;
+        /// times the copy started over because another connection wrote to the source
+        int restarts = 0;
+
+        inline double fraction() const {
+            return total_pages ? 1 - static_cast<double>(remaining_pages) / static_cast<double>(total_pages) : 0;
+        }
+    };
+
+    /// called after every step of a backup, returning false cancels it
+    using backup_progress_sink = std::function<bool(const backup_progress &)>;
+
+    /// see DBHelper::enable_result_cache
+    struct result_cache_stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        /// results dropped because their table was written to since they were read
+        size_t invalidations = 0;
+        size_t entries = 0;
+        /// estimated bytes held by the cached keys and results
+        size_t memory_usage = 0;
+
+        inline double hit_ratio() const {
+            return hits + misses == 0 ? 0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+    /// column of a table as reported by PRAGMA table_info
+    struct column_schema {
+        std::string name;
+        /// the type as declared, empty if none was
+        std::string declared_type;
+        bool not_null = false;
+        /// the default as sql text, empty if there is none
+        std::string default_value;
+        /// position in the primary key counted from 1, 0 if the column isn't part of it
+        int primary_key_position = 0;
+    };
+
+    struct index_schema {
+        std::string name;
+        bool unique = false;
+        /// "c" created by CREATE INDEX, "u" by a UNIQUE constraint, "pk" by a PRIMARY KEY constraint
+        std::string origin;
+        /// indexed columns in key order, expressions show up as empty names
+        std::vector<std::string> columns;
+    };
+
+    /// see DBHelper::get_schema
+    struct table_schema {
+        std::string name;
+        /// in declaration order, which is the order of the columns of SELECT *
+        std::vector<column_schema> columns;
+        /// column names in key order, empty for tables keyed by the rowid alone
+        std::vector<std::string> primary_key;
+        std::vector<index_schema> indexes;
+
+        /// @return position of <b>column</b> among the columns, -1 if the table has none named like that
+        int column_index(std::string_view column) const;
+    };
+
+private:
+    statement_cache_stats cache_stats;
+
+    bool instrumentation = false;
+    /// keyed by the sql as prepared, bound values aren't part of it
+    std::unordered_map<std::string, query_stats> stats_by_sql;
+    struct traced_statement {
+        /// key of <b>stats</b> in stats_by_sql, compared on lookup as sqlite reuses freed statement addresses
+        const std::string *sql;
+        query_stats *stats;
+        /// INSERT/UPDATE/DELETE, rows are counted with sqlite3_changes instead of returned rows
+        bool changes_rows;
+    };
+    /// statements seen by trace_callback, saves building a string key for every traced event
+    std::unordered_map<sqlite3_stmt *, traced_statement> stats_by_statement;
+
+    /// negative while the slow query log is off
+    std::chrono::nanoseconds slow_query_threshold{-1};
+    slow_query_sink slow_query_log;
+    /// captured by trace_callback, planned and handed to the sink outside of it by flush_slow_queries
+    std::vector<slow_query> slow_queries;
+    /// the EXPLAIN QUERY PLAN statements of a flush are never logged themselves
+    bool flushing_slow_queries = false;
+
+    /// one result of a query run through read_through
+    struct cached_result {
+        /// the sql followed by the encoded bound values
+        std::string key;
+        std::any value;
+        /// write counter of the table read, in table_generations
+        const uint64_t *table_generation;
+        /// <b>*table_generation</b> when the result was read, the result is stale once they differ
+        uint64_t generation;
+        size_t bytes;
+    };
+    /// results of try_get/select, most recently used at the front
+    std::list<cached_result> result_cache;
+    /// lookup into result_cache, keys view the keys stored in the list
+    std::unordered_map<std::string_view, decltype(result_cache)::iterator> result_cache_index;
+    /// bytes the cached results may take, 0 while the result cache is off
+    size_t result_cache_capacity = 0;
+    size_t result_cache_bytes = 0;
+    result_cache_stats result_stats;
+    /// bumped by update_hook for every row written, keyed by the lower case table name
+    std::unordered_map<std::string, uint64_t> table_generations;
+    /// connection::hooked_changes and sqlite3_total_changes64 at the last check
+    int64_t checked_hooked_changes = 0;
+    int64_t checked_total_changes = 0;
+    /// PRAGMA data_version and schema_version at the last full check, data_version changes when another
+    /// connection commits, schema_version on DROP/ALTER
+    int64_t checked_data_version = -1;
+    int64_t checked_schema_version = -1;
+    /// SQLITE_FCNTL_DATA_VERSION at the last full check, moves with every commit the connection has seen
+    unsigned int checked_file_version = 0;
+    std::chrono::steady_clock::time_point checked_at;
+    /// how long a result may miss commits of other connections, see enable_result_cache
+    std::chrono::milliseconds result_cache_staleness{100};
+
+    /// schemas read since the schema last changed, keyed by the lower case table name, nullptr for missing tables
+    std::unordered_map<std::string, std::shared_ptr<const table_schema>> schema_cache;
+    /// names of the tables in sqlite_master, loaded by table_exists with the schema version they belong to
+    std::unordered_set<std::string> table_names;
+    bool table_names_loaded = false;
+    /// PRAGMA schema_version the cached schemas were read at
+    int64_t schema_cache_version = -1;
+    /// the schemas were read inside a transaction, a rollback may have undone what they show
+    bool schema_cache_tentative = false;
+    /// PRAGMA schema_version, kept out of statement_cache so it doesn't show up in its stats or advise_indexes
+    std::unique_ptr<SQLite::Statement> schema_version_query;
+
 public:
     enum type {
         INTEGER,
@@ -46,6 +350,83 @@ public:
         AUTO_INCREMENT,
     };
 
+    enum transaction_type {
+        DEFERRED,
+        IMMEDIATE,
+        EXCLUSIVE,
+    };
+
+    class Transaction;
+
+    class Savepoint;
+
+    class Cursor;
+
+    enum profile {
+        /// WAL, synchronous FULL, every commit survives a power loss
+        DURABLE,
+        /// WAL, synchronous NORMAL, a power loss may roll back the last commits but never corrupts the database
+        BALANCED,
+        /// WAL, synchronous OFF and a big cache, for imports that can be redone after a crash
+        BULK_LOAD,
+        /// WAL, synchronous NORMAL with a big cache and memory mapped reads
+        READ_MOSTLY,
+    };
+
+    enum direction {
+        ASC,
+        DESC,
+    };
+
+    /// ORDER BY <b>column</b> <b>order</b> LIMIT <b>limit</b> OFFSET <b>offset</b>, a limit of 0 returns every row
+    struct order_by {
+        std::string column;
+        direction order = ASC;
+        size_t limit = 0;
+        size_t offset = 0;
+    };
+
+    /// one page of a keyset paginated select, see DBHelper::select_page
+    template<typename Row>
+    struct page {
+        std::vector<Row> rows;
+        /// pass to the next select_page call, empty once the last page was read
+        std::string next_token;
+    };
+
+    enum count_mode {
+        /// SELECT COUNT(*), walks the whole table unless the count is tracked
+        EXACT,
+        /// sqlite_stat1 row estimate left by ANALYZE, exact if the count is tracked
+        ESTIMATE,
+    };
+
+    /**
+     * @brief connection settings applied with PRAGMA statements, empty strings leave the setting unchanged
+     * @example
+     * @code
+     * DBHelper::options opts = DBHelper::options::of(DBHelper::BALANCED);
+     * opts.busy_timeout = 10000;
+     * DBHelper db_helper("/home/username/.local/share/ProjectName/database.db3", opts);
+     * @endcode
+     */
+    struct options {
+        /// DELETE, TRUNCATE, PERSIST, MEMORY, WAL or OFF
+        std::string journal_mode;
+        /// OFF, NORMAL, FULL or EXTRA
+        std::string synchronous;
+        /// pages if positive, KiB if negative, 0 leaves it unchanged
+        int cache_size = 0;
+        /// bytes of the file read through mmap, -1 leaves it unchanged
+        long long mmap_size = -1;
+        /// DEFAULT, FILE or MEMORY
+        std::string temp_store;
+        /// milliseconds to wait for a lock before failing with SQLITE_BUSY, -1 leaves it unchanged
+        int busy_timeout = -1;
+
+        static options of(profile p);
+    };
+
     /**
      * TODO: write documentation
      * creates db at a default location depending on the OS in use and the PERMISSION level
@@ -57,12 +438,34 @@ public:
      *  /var/ProjectName/database.db3\n\n
      * @example
      * <b>Windows:<b>\n\n
-     * <b>not supported yet</b>\n
+     * <b>not supported yet</b>
      */
     explicit DBHelper();
 
+    /**
+     * @brief opens <b>db_path</b> on a connection of its own\n
+     * ":memory:" opens an empty in memory database, "file:name?mode=memory&cache=shared" one shared by every
+     * DBHelper opening the same name, see load_from_file
+     */
     explicit DBHelper(const std::string &db_path);
 
+    /// @see DBHelper::shared(const std::string &db_path), opens the database at the default location
+    static std::unique_ptr<DBHelper> shared();
+
+    /**
+     * @brief opens <b>db_path</b>, or shares the connection another DBHelper this thread got from shared() has open
+     * to it, so short lived DBHelpers don't reopen the file and keep its page cache warm\n
+     * ":memory:" and URI file names always get a connection of their own
+     * @warning the DBHelpers sharing a connection share its transactions, pragmas, instrumentation and slow query
+     * log, a rollback through one of them undoes the writes of the others\n
+     * the connection is opened without a mutex, the DBHelper has to stay on the thread it was made on
+     * @example
+     * @code
+     * std::unique_ptr<DBHelper> db_helper = DBHelper::shared("/home/username/.local/share/ProjectName/database.db3");
+     * @endcode
+     */
+    static std::unique_ptr<DBHelper> shared(const std::string &db_path);
+
     explicit DBHelper(const int &permissions);
 
     /**
@@ -71,6 +474,17 @@ public:
     DBHelper(const std::string &db_path,
              const int &permissions);
 
+    /// opens the database at the default location and applies <b>opts</b>
+    explicit DBHelper(const options &opts);
+
+    /// opens the database at <b>db_path</b> and applies <b>opts</b>
+    DBHelper(const std::string &db_path,
+             const options &opts);
+
+    DBHelper(const DBHelper &) = delete;
+
+    DBHelper &operator=(const DBHelper &) = delete;
+
     ~DBHelper();
 
     SQLite::Database &db() { return *database; }
@@ -83,6 +497,110 @@ public:
 
     inline static void set_default_path(const std::string &path) { default_path = path; }
 
+    inline statement_cache_stats get_statement_cache_stats() const { return cache_stats; }
+
+    /**
+     * @brief applies the PRAGMA settings of <b>opts</b> to the open connection
+     * @warning journal_mode can't be changed inside a transaction, in memory databases can't use WAL
+     * @return false if any of the settings couldn't be applied, journal_mode included when sqlite kept another mode
+     */
+    bool configure(const options &opts);
+
+    /**
+     * @brief switches to a named profile at runtime
+     * @example
+     * @code
+     * db_helper.set_profile(DBHelper::BULK_LOAD);
+     * db_helper.insert_many("table_name", {"id"}, rows);
+     * db_helper.set_profile(DBHelper::BALANCED);
+     * @endcode
+     */
+    inline bool set_profile(profile p) { return configure(options::of(p)); }
+
+    inline size_t get_statement_cache_size() const { return statement_cache.size(); }
+
+    /**
+     * @brief sets how many prepared statements are kept per connection, 0 disables caching\n
+     * least recently used statements are evicted when the cache shrinks below its current size
+     */
+    void set_statement_cache_capacity(size_t capacity);
+
+    /// finalizes all cached statements, statements still held by callers stay valid
+    void clear_statement_cache();
+
+    /**
+     * @brief records calls, rows, prepare/step time and a latency histogram for every sql text run on this
+     * connection through sqlite3_trace_v2, the connection runs without a trace callback while disabled\n
+     * define DBHELPER_NO_INSTRUMENTATION to compile it out
+     * @example
+     * @code
+     * db_helper.enable_instrumentation();
+     * ...
+     * std::cout << db_helper.dump_query_stats(DBHelper::JSON);
+     * @endcode
+     */
+    void enable_instrumentation(bool enabled = true);
+
+    inline bool is_instrumented() const { return instrumentation; }
+
+    inline const std::unordered_map<std::string, query_stats> &get_query_stats() const { return stats_by_sql; }
+
+    void reset_query_stats();
+
+    /// @return the recorded stats sorted by total step time, one line per sql or a JSON array
+    std::string dump_query_stats(dump_format format = PLAIN_TEXT) const;
+
+    /**
+     * @brief reports every execution that runs at least <b>threshold</b> with its bound values, scan and sort
+     * counters and query plan to <b>sink</b>, std::cerr if no sink is given\n
+     * executions are captured as they finish and reported on the next DBHelper call or flush_slow_queries(),
+     * the plan can't be queried from inside sqlite's trace callback
+     * @warning the destructor flushes too, whatever <b>sink</b> captures has to outlive the DBHelper
+     * @example
+     * @code
+     * db_helper.set_slow_query_log(std::chrono::milliseconds(50), [](const DBHelper::slow_query &query) {
+     *     logger.warn(query.expanded_sql, query.elapsed.count(), query.plan);
+     * });
+     * @endcode
+     */
+    void set_slow_query_log(std::chrono::nanoseconds threshold, slow_query_sink sink = {});
+
+    void disable_slow_query_log();
+
+    /// plans and reports the slow executions captured since the last flush, exceptions of the sink go to std::cerr
+    void flush_slow_queries();
+
+    /**
+     * @brief caches the results of try_get() and the typed select<Row>() overloads keyed on their sql and bound
+     * values, least recently used results are evicted once the cache holds more than <b>max_bytes</b>\n
+     * a write to a table through this connection invalidates the results read from it, writes made through
+     * execute() or db() included (sqlite3_update_hook), commits of other connections and schema changes
+     * clear the whole cache\n
+     * only results of plain table names are cached, sqlite reports writes by table so reads of views, joins or
+     * schema qualified names always go to the database
+     * @param max_staleness a hit opens no read transaction and only notices commits this connection has seen,
+     * PRAGMA data_version is read to catch those of other connections once this much time has passed
+     * @warning ROLLBACK TO run through execute() isn't noticed, use rollback_to() or DBHelper::Savepoint
+     * @example
+     * @code
+     * db_helper.enable_result_cache(64 << 20);
+     * ...
+     * std::cout << db_helper.get_result_cache_stats().hit_ratio();
+     * @endcode
+     */
+    void enable_result_cache(size_t max_bytes = 16 << 20,
+                             std::chrono::milliseconds max_staleness = std::chrono::milliseconds(100));
+
+    /// drops every cached result and removes the hooks
+    void disable_result_cache();
+
+    inline bool is_result_cache_enabled() const { return result_cache_capacity > 0; }
+
+    result_cache_stats get_result_cache_stats() const;
+
+    /// drops every cached result, the cache stays enabled
+    void clear_result_cache();
+
     /**
      * use for more complicated queries that can't/are hard to be made generic
      * TODO: not working currently.. maybe..
@@ -91,13 +609,85 @@ public:
      */
     std::shared_ptr<SQLite::Statement> execute(const std::string &sql);
 
+    /// @brief looked up in the schema cache, see DBHelper::get_schema
     bool table_exists(const std::string &table_name);
 
+    /**
+     * @brief columns, declared types, primary key and indexes of <b>table_name</b>\n
+     * read once and cached until PRAGMA schema_version changes, which every CREATE, DROP or ALTER of this or another
+     * connection does, so repeated lookups cost one step of a cached pragma statement
+     * @return nullptr if there is no such table or view
+     * @example
+     * @code
+     * std::shared_ptr<const DBHelper::table_schema> schema = db_helper.get_schema("table_name");
+     * if (schema)
+     *     for (const DBHelper::column_schema &column: schema->columns)
+     *         std::cout << column.name << ' ' << column.declared_type << std::endl;
+     * @endcode
+     */
+    std::shared_ptr<const table_schema> get_schema(const std::string &table_name);
+
+    /**
+     * @brief position of <b>column</b> in the rows of select(<b>table_name</b>) and other SELECT * queries, read
+     * from the schema cache
+     * @return -1 if there is no such table or column
+     */
+    int column_index(const std::string &table_name, std::string_view column);
+
+    /// forgets every cached schema, they are read again on the next lookup
+    void clear_schema_cache();
+
+    /// @sqlite SELECT EXISTS(SELECT 1 FROM <b>table_name</b> LIMIT 1)
     bool table_empty(const std::string &table_name);
 
+    /**
+     * @brief amount of rows in <b>table_name</b>, read from the counter maintained by track_row_count() if there is one
+     * @param mode ESTIMATE falls back to SELECT COUNT(*) if the table was never analyzed
+     * @return -1 on error
+     */
+    long long row_count(const std::string &table_name, count_mode mode = EXACT);
+
+    /**
+     * @brief keeps the row count of <b>table_name</b> in <b>dbhelper_row_counts</b> with AFTER INSERT and AFTER DELETE
+     * triggers, so row_count() doesn't have to walk the table
+     * @sqlite CREATE TRIGGER dbhelper_count_<b>table_name</b>_insert AFTER INSERT ON <b>table_name</b> ...
+     * @warning INSERT OR REPLACE deletes conflicting rows without firing delete triggers unless
+     * PRAGMA recursive_triggers is on, which leaves the counter too high
+     * @return false on error
+     */
+    bool track_row_count(const std::string &table_name);
+
+    /// drops the triggers installed by track_row_count() and forgets the counter
+    bool untrack_row_count(const std::string &table_name);
+
+    /**
+     * @sqlite SELECT EXISTS(SELECT 1 FROM <b>table_name</b> WHERE <b>column</b>=? LIMIT 1)
+     * @return true if any row has <b>value</b> in <b>column</b>, answered by the column's Bloom filter if it has one
+     * and the value isn't in it
+     */
     template<typename T>
     bool exists(const std::string &table_name, const std::string &column, T value);
 
+    /**
+     * @brief keeps an in memory Bloom filter of <b>table_name</b>.<b>column</b> so exists() answers most lookups of
+     * missing values without touching sqlite\n
+     * the filter is filled from the table on the next exists() call, rows the connection writes afterwards (execute()
+     * and db() included) are read into it through sqlite3_update_hook, deleted values stay in the filter and only
+     * cost a regular lookup\n
+     * the filter belongs to the connection and serves every DBHelper DBHelper::shared opened on it, before it reports a
+     * value missing PRAGMA data_version is checked and a commit of another connection has it refilled
+     * @warning only columns with INTEGER or TEXT affinity and the default BINARY collation are supported
+     * @param expected_values the filter grows once more than twice as many values are added
+     * @return false if the column doesn't exist or its affinity or collation isn't supported
+     */
+    bool enable_bloom_filter(const std::string &table_name, const std::string &column,
+                             size_t expected_values = 65536, double false_positive_rate = 0.01);
+
+    void disable_bloom_filter(const std::string &table_name, const std::string &column);
+
+    /// refills the filter from the table on the next exists() call
+    void rebuild_bloom_filter(const std::string &table_name, const std::string &column);
+
     /**
      * @brief function for creating all the annoying table creation syntax, you only need to give the data in the
      * right order and the rest will be done for you
@@ -121,6 +711,57 @@ public:
      */
     std::string drop(const std::string &table_name);
 
+    /**
+     * @brief sqlite CREATE INDEX function, supports covering and partial indexes
+     * @sqlite CREATE [UNIQUE] INDEX IF NOT EXISTS <b>index_name</b> ON <b>table_name</b> (<b>columns...</b>, <b>covered_columns...</b>) [WHERE <b>where</b>]
+     * @example
+     * @code
+     * //  lookups by user_id that only read created_at never touch the table
+     * create_index("orders_user_id", "orders", {"user_id"}, {"created_at"});
+     * //  only indexes the rows that are still open
+     * create_index("orders_open", "orders", {"user_id"}, {}, "closed = 0");
+     * @endcode
+     * @param covered_columns appended after <b>columns</b> so queries reading only them are answered from the index
+     * @param where makes it a partial index holding only the matching rows
+     */
+    std::string create_index(const std::string &index_name, const std::string &table_name,
+                             const std::vector<std::string> &columns,
+                             const std::vector<std::string> &covered_columns = {},
+                             const std::string &where = {},
+                             bool unique = false);
+
+    /**
+     * @brief sqlite DROP INDEX function
+     * @sqlite DROP INDEX IF EXISTS <b>index_name</b>
+     */
+    std::string drop_index(const std::string &index_name);
+
+    /// index suggested for a statement whose query plan scans a whole table
+    struct index_advice {
+        /// the analysed statement
+        std::string sql;
+        /// detail of the SCAN step of EXPLAIN QUERY PLAN
+        std::string plan;
+        std::string table_name;
+        /// WHERE columns, equality comparisons first
+        std::vector<std::string> columns;
+        /// CREATE INDEX statement that would turn the scan into a search
+        std::string create_sql;
+    };
+
+    /**
+     * @brief runs EXPLAIN QUERY PLAN on <b>sql</b> and suggests an index on its WHERE columns if it scans a table
+     * @param auto_create creates the suggested index right away
+     * @return the advice, or nothing if the statement already uses an index or has no WHERE clause
+     */
+    std::optional<index_advice> advise_index(const std::string &sql, bool auto_create = false);
+
+    /**
+     * @brief advise_index for every statement in the statement cache, i.e. the statements select/get/dele/update
+     * recently generated
+     */
+    std::vector<index_advice> advise_indexes(bool auto_create = false);
+
 //======================================================================================================================
 
     /**
@@ -170,6 +811,50 @@ public:
     inline std::string
     insert(const std::string &table_name, const std::vector<std::pair<std::string, T>> &columns_values);
 
+    /**
+     * @brief Sqlite INSERT function for structs mapped with DBHELPER_ROW
+     * @sqlite
+     * INSERT INTO <b>table_name</b> (<b>DBRow<Row>::columns</b>) VALUES (<b>row members...</b>);
+     * @example
+     * \code
+     * insert("users", User{1, "name", std::nullopt});
+     *
+     * result:
+     * INSERT INTO users (id, name, email) VALUES (?, ?, ?);
+     * \endcode
+     */
+    template<typename Row>
+    inline std::enable_if_t<is_db_row_v<Row>, std::string>
+    insert(const std::string &table_name, const Row &row);
+
+    /**
+     * @brief inserts many rows at once, rows are split into multi-row INSERT statements sized under sqlite's bound
+     * variable limit and inserted inside one savepoint, nothing is inserted if any chunk fails
+     * @sqlite
+     * INSERT INTO <b>table_name</b> (<b>columns...</b>) VALUES (<b>row...</b>), (<b>row...</b>)...;
+     * @example
+     * \code
+     * std::vector<std::tuple<int, std::string>> rows = {{1, "a"}, {2, "b"}};
+     * insert_many("table_name", {"id", "val"}, rows);
+     *
+     * result:
+     * INSERT INTO table_name (id, val) VALUES (?, ?), (?, ?);
+     * \endcode
+     * @param rows sized range of tuple like rows (std::tuple, std::pair, std::array), one element per column
+     * @return number of inserted rows
+     */
+    template<typename Rows>
+    inline size_t
+    insert_many(const std::string &table_name, const std::vector<std::string> &columns, const Rows &rows);
+
+    /**
+     * @brief insert_many for structs mapped with DBHELPER_ROW, every mapped column is inserted
+     * @see DBHelper::insert_many
+     */
+    template<typename Rows>
+    inline size_t
+    insert_many(const std::string &table_name, const Rows &rows);
+
 //======================================================================================================================
 
     template<typename Col, typename Op, typename Val>
@@ -211,6 +896,7 @@ public:
      * @warning
      * may produce "database locked" error
      * make sure to only return this function to variable in local space like a function/method\n
+     * the statement behind the column is cached, the column is only valid until the same get is called again\n
      * TODO: better documentation
      */
     template<typename T>
@@ -244,6 +930,58 @@ public:
     get(const std::string &table_name, const std::string &column,
         const std::vector<std::tuple<Col, Op, Val>> &conditions);
 
+    /**
+     * @brief typed get that copies the value out and resets the cached statement before returning, a missing row
+     * isn't an error
+     * @sqlite SELECT <b>column</b> FROM <b>table_name</b> WHERE <b>condition_column</b>=<b>condition_value</b>
+     * @example
+     * @code
+     * if (std::optional<std::string> name = db_helper.try_get<std::string>("users", "name", "id", 1))
+     *     std::cout << *name;
+     * @endcode
+     * @return the value of the first matching row, empty if there is none, the value is NULL or the query failed
+     */
+    template<typename V, typename T>
+    inline std::optional<V>
+    try_get(const std::string &table_name, const std::string &column,
+            const std::string &condition_column, const T &condition_value);
+
+    /// @see DBHelper::try_get
+    template<typename V, typename Col, typename Op, typename Val>
+    inline std::optional<V>
+    try_get(const std::string &table_name, const std::string &column, const std::tuple<Col, Op, Val> &condition);
+
+    /// @see DBHelper::try_get
+    template<typename V, typename Col, typename Op, typename Val>
+    inline std::optional<V>
+    try_get(const std::string &table_name, const std::string &column,
+            const std::vector<std::tuple<Col, Op, Val>> &conditions);
+
+    /**
+     * @brief fetches <b>column</b> of every row whose <b>key_column</b> is one of <b>keys</b>, keys are sent in
+     * chunks of up to 500 bound values, a chunk is padded with its last key up to the next power of two (or 500) so
+     * key lists of similar length share a cached statement
+     * @sqlite SELECT <b>key_column</b>, <b>column</b> FROM <b>table_name</b> WHERE <b>key_column</b> IN (?, ?, ...)
+     * @example
+     * @code
+     * std::unordered_map<int64_t, std::string> names = db_helper.get_many<std::string>("users", "name", "id", ids);
+     * @endcode
+     * @return value by key, keys without a row are left out and only the first row of a repeated key is kept
+     */
+    template<typename V, typename K>
+    inline std::unordered_map<K, V>
+    get_many(const std::string &table_name, const std::string &column, const std::string &key_column,
+             const std::vector<K> &keys);
+
+    /**
+     * @brief get_many returning the values in the order of <b>keys</b>
+     * @return one element per key, empty for keys without a row
+     */
+    template<typename V, typename K>
+    inline std::vector<std::optional<V>>
+    get_many_aligned(const std::string &table_name, const std::string &column, const std::string &key_column,
+                     const std::vector<K> &keys);
+
 //======================================================================================================================
 
     /**
@@ -354,6 +1092,97 @@ public:
            std::initializer_list<std::string> columns,
            const std::vector<std::tuple<Col, Op, Val>> &conditions);
 
+    /**
+     * @sqlite SELECT * FROM <b>table_name</b> ORDER BY <b>ordering.column</b> LIMIT ? OFFSET ?
+     * @warning OFFSET still steps through every skipped row, page deep into big tables with select_page
+     */
+    std::shared_ptr<SQLite::Statement>
+    select(const std::string &table_name, const order_by &ordering);
+
+    /// @sqlite SELECT * FROM <b>table_name</b> WHERE <b>condition</b> ORDER BY <b>ordering.column</b> LIMIT ? OFFSET ?
+    template<typename Col, typename Op, typename Val>
+    inline std::shared_ptr<SQLite::Statement>
+    select(const std::string &table_name, const std::tuple<Col, Op, Val> &condition, const order_by &ordering);
+
+    /// @sqlite SELECT * FROM <b>table_name</b> WHERE <b>conditions...</b> ORDER BY <b>ordering.column</b> LIMIT ? OFFSET ?
+    template<typename Col, typename Op, typename Val>
+    inline std::shared_ptr<SQLite::Statement>
+    select(const std::string &table_name, const std::vector<std::tuple<Col, Op, Val>> &conditions,
+           const order_by &ordering);
+
+    /**
+     * @brief reads every row into structs mapped with DBHELPER_ROW, columns are decoded by index
+     * @sqlite SELECT <b>DBRow<Row>::columns</b> FROM <b>table_name</b>
+     * @example
+     * @code
+     * std::vector<User> users = db_helper.select<User>("users");
+     * @endcode
+     */
+    template<typename Row>
+    inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+    select(const std::string &table_name);
+
+    /**
+     * @sqlite SELECT <b>DBRow<Row>::columns</b> FROM <b>table_name</b> WHERE <b>condition_column</b> <b>condition</b> <b>condition_value</b>
+     * @see DBHelper::select<Row>(const std::string &table_name)
+     */
+    template<typename Row, typename Col, typename Op, typename Val>
+    inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+    select(const std::string &table_name, const std::tuple<Col, Op, Val> &condition);
+
+    /**
+     * @sqlite SELECT <b>DBRow<Row>::columns</b> FROM <b>table_name</b> WHERE <b>conditions...</b>
+     * @see DBHelper::select<Row>(const std::string &table_name)
+     */
+    template<typename Row, typename Col, typename Op, typename Val>
+    inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+    select(const std::string &table_name, const std::vector<std::tuple<Col, Op, Val>> &conditions);
+
+    /**
+     * @brief keyset ("seek") pagination, each page continues after the last row of the previous one through an index
+     * on <b>key_column</b> instead of skipping rows with OFFSET, so every page costs the same\n
+     * rows are ordered by <b>key_column</b> and then rowid, the key doesn't have to be unique
+     * @sqlite SELECT rowid, <b>key_column</b>, <b>DBRow<Row>::columns</b> FROM <b>table_name</b>
+     * WHERE <b>conditions...</b> AND <b>key_column</b>>=? AND (<b>key_column</b>>? OR rowid>?)
+     * ORDER BY <b>key_column</b>, rowid LIMIT ?
+     * @example
+     * @code
+     * std::string token;
+     * do {
+     *     DBHelper::page<User> users = db_helper.select_page<User>("users", "created", 100, token);
+     *     ...
+     *     token = users.next_token;
+     * } while (!token.empty());
+     * @endcode
+     * @param token empty for the first page, then the next_token of the previous page
+     * @warning rows with a NULL key are never returned and WITHOUT ROWID tables aren't supported\n
+     * BLOB keys are carried hex encoded, the token of a blob key is twice its size
+     */
+    template<typename Row, typename Col = std::string, typename Op = std::string, typename Val = int>
+    inline std::enable_if_t<is_db_row_v<Row>, page<Row>>
+    select_page(const std::string &table_name, const std::string &key_column, size_t page_size,
+                const std::string &token = {}, const std::vector<std::tuple<Col, Op, Val>> &conditions = {},
+                direction order = ASC);
+
+    /**
+     * @brief same as select but returns a move only Cursor for range based for loops, rows don't allocate and text/blob
+     * columns are views into sqlite's buffers
+     * @example
+     * @code
+     * for (auto row : db_helper.scan("table_name", std::make_tuple("id", ">", 1), "id", "val")) {
+     *     int id = row.get_int(0);
+     *     std::string_view val = row.get_text(1);
+     * }
+     * @endcode
+     * @see DBHelper::select
+     */
+    template<typename ...Args>
+    inline Cursor scan(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::scan
+    template<typename ...Args>
+    inline Cursor scan(const std::string &table_name, std::initializer_list<std::string> columns, Args &&...args);
+
 //======================================================================================================================
 
     /**
@@ -381,16 +1210,371 @@ public:
     update(const std::string &table_name, std::vector<std::tuple<std::string, std::string, T>> conditions,
            Args ...args);
 
+    /**
+     *  @brief Sqlite UPDATE function for structs mapped with DBHELPER_ROW, every mapped column is set
+     *  @sqlite UPDATE <b>table_name</b> SET (<b>DBRow<Row>::columns</b>=?)... WHERE <b>condition_column</b> <b>condition</b> <b>condition_value</b>
+     */
+    template<typename Row, typename Col, typename Op, typename Val>
+    inline std::enable_if_t<is_db_row_v<Row>, std::string>
+    update(const std::string &table_name, const std::tuple<Col, Op, Val> &condition, const Row &row);
+
 //======================================================================================================================
 
     /// writes whole table to command line interface
     void write_to_cli(const std::string &table_name);
 
+    /**
+     * @brief streams every row of <b>table_name</b> to <b>fd</b>, see export_rows
+     * @sqlite SELECT * FROM <b>table_name</b>
+     * @example
+     * @code
+     * int fd = open("table_name.csv", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+     * long long rows = db_helper.export_table("table_name", fd, DBHelper::CSV);
+     * close(fd);
+     * @endcode
+     */
+    long long export_table(const std::string &table_name, int fd, export_format format);
+
+    /**
+     * @brief steps <b>query</b> to its end and writes its remaining rows to <b>fd</b> through a 1 MiB buffer,
+     * column names are read once and formatted rows are never allocated
+     * @param query any statement, e.g. the result of select()
+     * @param fd left open, also for pipes and sockets
+     * @return rows written, -1 if the query or a write failed
+     */
+    long long export_rows(SQLite::Statement &query, int fd, export_format format);
+
+    /// @see DBHelper::import_file
+    import_stats import_file(const std::string &table_name, const std::string &path);
+
+    /**
+     * @brief loads a CSV or JSON Lines file into <b>table_name</b>, the file is memory mapped and parsed on
+     * <b>opts.threads</b> threads while this one inserts the parsed rows with multi row INSERTs, committing every
+     * <b>opts.rows_per_transaction</b> rows\n
+     * values are converted by the affinity of their column, CSV fields and JSON keys without a column are skipped,
+     * columns missing from a JSON line are NULL
+     * @sqlite INSERT INTO <b>table_name</b> (<b>columns...</b>) VALUES (?, ...), ...
+     * @warning inside a transaction opened by the caller nothing is committed and a failed insert leaves the rows
+     * inserted before it, rolling back is up to the caller\n
+     * a failed insert otherwise rolls back the rows inserted since the last commit
+     * @example
+     * @code
+     * DBHelper::import_stats stats = db_helper.import_file("table_name", "/tmp/dump.csv");
+     * std::cout << stats.rows_per_second() << " rows/s, " << stats.bytes_per_second() / 1e6 << " MB/s";
+     * @endcode
+     */
+    import_stats import_file(const std::string &table_name, const std::string &path, const import_options &opts);
+
+    /**
+     * @brief copies the database to <b>path</b> while it stays in use, <b>pages_per_step</b> pages at a time with a
+     * <b>pause</b> between the steps on a thread of its own, the source is only locked while a step runs\n
+     * the copy reads through a connection of its own, a write of any other connection makes sqlite start it over,
+     * writes keep being picked up until a pass gets through without one
+     * @sqlite sqlite3_backup_init, sqlite3_backup_step, sqlite3_backup_finish
+     * @param pages_per_step 0 or less copies everything in one step
+     * @param pause also how long a locked source or destination is waited for before a step is retried, a lock is
+     * retried for at most backup_lock_retries steps in a row before the backup gives up, 0 gives up on a lock
+     * @param progress runs on the backup thread after every step, returning false cancels the backup
+     * @return future that's true once <b>path</b> holds a complete copy\n
+     * in memory databases can't be opened by another connection, they are copied in one step on this thread
+     * @warning the future is from std::async, destroying it waits for the backup, <b>path</b> is overwritten and
+     * holds part of a copy if the backup fails or is cancelled
+     * @example
+     * @code
+     * std::future<bool> done = db_helper.backup_to("/tmp/backup.db3", 256, std::chrono::milliseconds(10),
+     *         [](const DBHelper::backup_progress &progress) {
+     *             std::cout << progress.fraction() * 100 << "%" << std::endl;
+     *             return true;
+     *         });
+     * ...
+     * if (!done.get())
+     *     //  the backup failed
+     * @endcode
+     */
+    std::future<bool> backup_to(const std::string &path, int pages_per_step = 256,
+                                std::chrono::milliseconds pause = std::chrono::milliseconds(10),
+                                backup_progress_sink progress = {});
+
+    /**
+     * @brief copies the database into a new in memory database in one step, for analytics that shouldn't compete
+     * with the writers of the file\n
+     * the copy is taken through this connection, so it includes writes of an open transaction
+     * @sqlite sqlite3_backup_init, sqlite3_backup_step, sqlite3_backup_finish
+     * @return nullptr if the copy failed
+     */
+    std::unique_ptr<DBHelper> snapshot_to_memory();
+
+    /// @return true for ":memory:" and in memory URIs (mode=memory, vfs=memdb), which live as long as their connection
+    bool is_in_memory() const;
+
+    /**
+     * @brief replaces the whole database with the one in <b>path</b>, for fixtures and read mostly services that
+     * should start from a file without warming a disk cache\n
+     * a ":memory:" database takes the image in one read through sqlite3_serialize/sqlite3_deserialize, others,
+     * shared cache URIs included, are overwritten in one step of the backup API\n
+     * the statement, schema and result caches are cleared and Bloom filters are rebuilt on their next lookup
+     * @sqlite sqlite3_serialize, sqlite3_deserialize
+     * @warning fails inside a transaction, the database then keeps the contents it had
+     * @example
+     * @code
+     * DBHelper db_helper(":memory:");
+     * db_helper.load_from_file("/home/username/.local/share/ProjectName/fixture.db3");
+     * ...
+     * db_helper.save_to_file("/tmp/after_test.db3");
+     * @endcode
+     */
+    bool load_from_file(const std::string &path);
+
+    /**
+     * @brief writes the whole database to <b>path</b> in one step of the backup API, the file is overwritten
+     * under its lock, so connections that have it open see either the old or the new contents
+     * @sqlite sqlite3_backup_init, sqlite3_backup_step, sqlite3_backup_finish
+     * @see DBHelper::backup_to for copying a database that is being written to
+     */
+    bool save_to_file(const std::string &path);
+
+//======================================================================================================================
+
+    /**
+     * @brief starts a transaction, every following insert/update/dele is committed at once by commit()
+     * @sqlite BEGIN <b>DEFERRED|IMMEDIATE|EXCLUSIVE</b> TRANSACTION
+     * @example
+     * @code
+     * db_helper.begin(DBHelper::IMMEDIATE);
+     * for (int i = 0; i < 100000; ++i)
+     *     db_helper.insert("table_name", "id", i);
+     * db_helper.commit();
+     * @endcode
+     * @return false if the transaction couldn't be started
+     */
+    bool begin(transaction_type behavior = DEFERRED);
+
+    /// @sqlite COMMIT TRANSACTION
+    bool commit();
+
+    /// @sqlite ROLLBACK TRANSACTION
+    bool rollback();
+
+    /**
+     * @brief savepoints can be nested and opened outside of a transaction in which case they start one
+     * @sqlite SAVEPOINT <b>name</b>
+     */
+    bool savepoint(const std::string &name);
+
+    /// @sqlite RELEASE SAVEPOINT <b>name</b>
+    bool release(const std::string &name);
+
+    /**
+     * @brief undoes everything done since the savepoint, the savepoint itself stays open
+     * @sqlite ROLLBACK TO SAVEPOINT <b>name</b>
+     */
+    bool rollback_to(const std::string &name);
+
+    /// @return true if a transaction is open on the connection
+    bool in_transaction();
+
 private:
 
+    /// selects the constructor DBHelper::shared uses
+    struct shared_tag {
+    };
+
+    DBHelper(const std::string &db_path, shared_tag);
+
+    /// attaches to the registry's connection to db_full_path for this thread, opening it if there is none
+    void open_shared();
+
+    /// opens a connection no other DBHelper gets
+    void open(int permissions);
+
+    void attach(std::shared_ptr<connection> opened);
+
+    /**
+     * @brief returns a reset statement with cleared bindings for sql, reusing a cached one when possible\n
+     * a cached statement still held by a caller (e.g. a select result) is never handed out twice,
+     * a fresh uncached one is prepared instead
+     */
+    std::shared_ptr<SQLite::Statement> prepare(const std::string &sql);
+
+    /// resets every idle cached statement so none of them keeps a read lock open
+    void reset_statement_cache();
+
+    void evict_statements(size_t capacity);
+
     static std::string intersected_questionmarks(int num);
 
-    std::string get_default_dir_path(const std::string &db_name);
+    /// @return " ORDER BY column ASC LIMIT ? OFFSET ?", the limit and offset are bound by bind_order_by
+    static std::string format_order_by(const order_by &ordering);
+
+    static void bind_order_by(SQLite::Statement &query, int index, const order_by &ordering);
+
+    /// @return rowid and key of the current row of a select_page query encoded into a continuation token
+    static std::string page_token(const SQLite::Statement &query);
+
+    /**
+     * @brief binds the key of <b>token</b> to <b>index</b> and <b>index</b> + 1 and its rowid to <b>index</b> + 2
+     * @throws std::invalid_argument if the token wasn't made by page_token
+     */
+    static void bind_page_token(SQLite::Statement &query, int index, const std::string &token);
+
+    /**
+     * @brief returns the cached result of <b>key</b> followed by <b>values</b> or caches what <b>load</b> returns,
+     * calls <b>load</b> directly while the result cache is off\n
+     * exceptions thrown by <b>load</b> pass through and nothing is cached
+     */
+    template<typename R, typename Load, typename ...Values>
+    inline R read_through(const std::string &table_name, std::string key, Load &&load, const Values &...values);
+
+    /// appends <b>value</b> tagged with its type so keys with different values never collide
+    template<typename T>
+    static inline void append_cache_key(std::string &key, const T &value);
+
+    /// @return estimated heap memory owned by <b>value</b>
+    template<typename T>
+    static inline size_t heap_size(const T &value);
+
+    /// clears the cache if sqlite reports writes the update hook hasn't seen, another connection's commit or a
+    /// schema change since the last lookup
+    void validate_result_cache();
+
+    /// @return write counter of <b>table_name</b> that update_hook bumps
+    const uint64_t *table_generation(const std::string &table_name);
+
+    void store_result(const std::string &table_name, std::string key, std::any value, size_t bytes);
+
+    void evict_results(size_t capacity);
+
+    /// drops the cached schemas if PRAGMA schema_version changed since they were read
+    void validate_schema_cache();
+
+    /// reads the schema of <b>table_name</b> from the pragmas, nullptr if there is no such table
+    std::shared_ptr<const table_schema> load_schema(const std::string &table_name);
+
+    /// how many steps in a row copy_pages retries on a locked source or destination before it gives up
+    static constexpr int backup_lock_retries = 100;
+
+    /**
+     * @brief runs a backup from <b>source</b> to <b>destination</b> step by step until it's done, failed or cancelled
+     * @throws SQLite::Exception if a step fails
+     */
+    static bool copy_pages(sqlite3 *source, sqlite3 *destination, int pages_per_step, std::chrono::milliseconds pause,
+                           const backup_progress_sink &progress);
+
+    /// installs the update and rollback hooks while a DBHelper sharing the connection caches results
+    void update_hooks();
+
+    /// sqlite3_update_hook callback, <b>context</b> is the connection, bumps the counters of every DBHelper caching on it
+    static void update_hook(void *context, int operation, const char *database_name, const char *table_name,
+                            long long rowid);
+
+    /// sqlite3_rollback_hook callback, results read inside the transaction may show rolled back writes
+    static void rollback_hook(void *context);
+
+    /// sqlite3_trace_v2 callback, <b>context</b> is the connection, the event is passed on to every DBHelper on it
+    static int trace_callback(unsigned event, void *context, void *p, void *x);
+
+    /// reinstalls or removes the trace callback after instrumentation was toggled
+    void update_trace_callback();
+
+    traced_statement &stats_of(sqlite3_stmt *statement);
+
+    /// @return handle to the cached <b>query</b> that resets it once the last copy of the handle is dropped
+    static std::shared_ptr<SQLite::Statement> lend_statement(const std::shared_ptr<SQLite::Statement> &query);
+
+    /// prepares <b>sql</b> without the statement cache, timed into stats_by_sql while instrumented
+    std::shared_ptr<SQLite::Statement> compile(const std::string &sql);
+
+    /// @return the filter of <b>table_name</b>.<b>column</b> filled from the table if needed, nullptr if it has none
+    column_filter *bloom_filter(const std::string &table_name, std::string_view column);
+
+    void populate_bloom_filter(const std::string &table_name, std::string_view column, column_filter &filter);
+
+    /// reads the rows update_hook saw written into <b>filter</b>
+    void add_written_rows(const std::string &table_name, std::string_view column, column_filter &filter);
+
+    /// adds a value read from the column of <b>filter</b>
+    static void add_column_value(column_filter &filter, const SQLite::Column &value);
+
+    /// @return false if another connection committed or rows were written past the hook since <b>filter</b> was filled
+    bool bloom_filter_current(column_filter &filter);
+
+    /// @return PRAGMA data_version of the connection
+    int64_t data_version();
+
+    /**
+     * @return the text a looked up value is kept under in a column_filter, nothing if the filter can't answer for it
+     * (NULL, floating point and blob values or text compared against an INTEGER column)
+     */
+    template<typename T>
+    static inline std::optional<std::string> bloom_key(const T &value, bool integer_affinity);
+
+    /// ?, ?, ... with <b>N</b> question marks built at compile time
+    template<size_t N>
+    struct question_marks {
+        static constexpr std::array<char, N * 3> chars = [] {
+            std::array<char, N * 3> result{};
+            for (size_t i = 0; i < N; ++i) {
+                result[i * 3] = '?';
+                result[i * 3 + 1] = ',';
+                result[i * 3 + 2] = ' ';
+            }
+            return result;
+        }();
+
+        static constexpr std::string_view view() { return {chars.data(), N == 0 ? 0 : N * 3 - 2}; }
+    };
+
+    /// sql generated by the variadic insert/update templates together with the names it was generated from
+    struct generated_sql {
+        std::vector<std::string> key;
+        std::string sql;
+
+        template<typename Args, size_t... indexes, typename ...Extra>
+        inline bool matches(integer_pack<size_t, indexes...>, const Args &args, const Extra &...extra) const;
+
+        template<typename Args, size_t... indexes, typename ...Extra>
+        inline const std::string &
+        assign(std::string generated, integer_pack<size_t, indexes...>, const Args &args, const Extra &...extra);
+    };
+
+    /**
+     * @brief the last few generated_sql of one template instantiation, every instantiation keeps one per thread, so
+     * repeated calls with the same table and columns only compare the names instead of formatting the sql again\n
+     * calls alternating between up to <b>slots</b> tables or column orders all stay cached, past that the oldest
+     * one is replaced
+     */
+    template<size_t slots>
+    struct generated_sql_cache {
+        std::array<generated_sql, slots> entries;
+        size_t next = 0;
+
+        /// @return the cached sql for the names, <b>generate</b>() stored in place of the oldest entry if there's none
+        template<typename Generate, typename Args, size_t... indexes, typename ...Extra>
+        inline const std::string &get(const Generate &generate, integer_pack<size_t, indexes...> columns,
+                                      const Args &args, const Extra &...extra);
+    };
+
+    /// @return string_view of string like arguments, anything else formatted into a std::string
+    template<typename T>
+    static inline auto as_text(const T &t);
+
+    /// @return INSERT INTO <b>table_name</b> (<b>columns...</b>) VALUES (?, ...) for the first half of <b>args</b>
+    template<typename ...Args>
+    static inline const std::string &insert_sql(const std::string &table_name, const Args &...args);
+
+    /**
+     * @return UPDATE <b>table_name</b> SET <b>column</b>=?, ... WHERE <b>where...</b>?
+     * for every second argument of <b>args</b> starting at the first
+     */
+    template<typename Args, size_t... indexes, typename ...Where>
+    static inline const std::string &
+    update_sql(const std::string &table_name, integer_pack<size_t, indexes...> columns, const Args &args,
+               const Where &...where);
+
+    static std::string get_default_dir_path(const std::string &db_name);
+
+    /// get_default_dir_path("database.db3"), the same for the whole run so it's built once
+    static const std::string &default_db_path();
 
     void set_db_name(const std::string &full_path);
 
@@ -411,6 +1595,59 @@ private:
     template<typename T>
     inline std::string as_questionmark(const T &t);
 
+    /// @return INSERT INTO <b>table_name</b> (<b>columns...</b>) VALUES (?, ...), ... with <b>row_count</b> rows
+    static std::string
+    multi_row_insert_sql(const std::string &table_name, const std::vector<std::string> &columns, size_t row_count);
+
+    /// @return how many rows of <b>column_count</b> values fit in one statement
+    size_t max_rows_per_statement(size_t column_count);
+
+    /// binds a tuple like row or a struct mapped with DBHELPER_ROW starting after the <b>offset</b> parameter
+    template<typename Row>
+    inline void bind_row(SQLite::Statement &query, int offset, const Row &row);
+
+    /// @return amount of columns of a tuple like row or a struct mapped with DBHELPER_ROW
+    template<typename Row>
+    static constexpr size_t row_size();
+
+    /**
+     * @brief binds integers, floating points, strings, blobs (std::vector<char>) and std::optional of them,
+     * std::nullopt and nullptr are bound as NULL
+     */
+    template<typename T>
+    static inline void bind_value(SQLite::Statement &query, int index, const T &value);
+
+    /// reads the column into any type accepted by DBHelper::bind_value
+    template<typename T>
+    static inline void read_column(const SQLite::Column &column, T &value);
+
+    /// read_column for column <b>index</b> of the current row of <b>statement</b>
+    template<typename T>
+    static inline void read_column(sqlite3_stmt *statement, int index, T &value);
+
+    /// @return the first column of the first row, resets <b>query</b> either way
+    template<typename V>
+    static inline std::optional<V> read_first(SQLite::Statement &query);
+
+    /// @param offset index of the column holding the first member
+    template<typename Row>
+    static inline Row read_row(const SQLite::Statement &query, int offset = 0);
+
+    /// @param indexes index of the column holding every member, in DBRow order
+    template<typename Row>
+    static inline Row read_row(const SQLite::Statement &query, const std::vector<int> &indexes);
+
+    template<typename Row>
+    static inline std::vector<Row> read_rows(SQLite::Statement &query);
+
+    /// @return <b>DBRow<Row>::columns</b> split into column names
+    template<typename Row>
+    static inline const std::vector<std::string> &row_columns();
+
+    /// @return <b>DBRow<Row>::columns</b> formatted as column1=?, column2=?...
+    template<typename Row>
+    static inline const std::string &row_question_mark_equation_comma();
+
     template<typename Args, size_t... indexes>
     inline void bind(SQLite::Statement &query, integer_pack<size_t, indexes...>, Args &&args);
 
@@ -419,7 +1656,194 @@ private:
     format_into_question_mark_equation_logic(const std::vector<std::tuple<Col, Op, Val>> &conditions);
 
     template<typename Args, size_t... indexes>
-    std::string format_into_question_mark_equation_comma(integer_pack<size_t, indexes...>, Args &&args);
+    static std::string format_into_question_mark_equation_comma(integer_pack<size_t, indexes...>, Args &&args);
+};
+
+/**
+ * @brief RAII transaction, rolls back on destruction unless commit() was called
+ * @example
+ * @code
+ * DBHelper::Transaction transaction(db_helper, DBHelper::IMMEDIATE);
+ * db_helper.insert("table_name", "id", 1);
+ * transaction.commit();
+ * @endcode
+ */
+class DBHelper::Transaction {
+    DBHelper &db_helper;
+    bool active;
+
+public:
+    explicit Transaction(DBHelper &db_helper, transaction_type behavior = DEFERRED);
+
+    Transaction(const Transaction &) = delete;
+
+    Transaction &operator=(const Transaction &) = delete;
+
+    ~Transaction();
+
+    bool commit();
+
+    bool rollback();
+
+    /// @return false if the transaction couldn't be started or has already ended
+    inline bool is_active() const { return active; }
+};
+
+/**
+ * @brief RAII savepoint, can be nested inside a Transaction or other Savepoints\n
+ * rolls back to and releases the savepoint on destruction unless release() was called
+ * @example
+ * @code
+ * DBHelper::Transaction transaction(db_helper);
+ * db_helper.insert("table_name", "id", 1);
+ * {
+ *     DBHelper::Savepoint savepoint(db_helper);
+ *     db_helper.insert("table_name", "id", 2);
+ * }   //  only id 2 is undone
+ * transaction.commit();
+ * @endcode
+ */
+class DBHelper::Savepoint {
+    DBHelper &db_helper;
+    std::string name;
+    bool active;
+
+public:
+    explicit Savepoint(DBHelper &db_helper);
+
+    Savepoint(const Savepoint &) = delete;
+
+    Savepoint &operator=(const Savepoint &) = delete;
+
+    ~Savepoint();
+
+    bool release();
+
+    bool rollback();
+
+    inline bool is_active() const { return active; }
+};
+
+/**
+ * @brief single pass range over the rows of a statement, resets the statement once destroyed\n
+ * a row and every view it returns are only valid until the cursor steps to the next row
+ */
+class DBHelper::Cursor {
+    std::shared_ptr<SQLite::Statement> query;
+    /// result column of every DBRow column of the row type last decoded with Row::as
+    std::vector<int> row_indexes;
+    const std::vector<std::string> *row_indexes_of = nullptr;
+
+public:
+    /// view into a blob column
+    struct blob_view {
+        const void *data;
+        size_t size;
+    };
+
+    class Row {
+        Cursor *cursor;
+        SQLite::Statement *query;
+
+    public:
+        explicit Row(Cursor *cursor) : cursor(cursor), query(cursor->query.get()) {}
+
+        inline int column_count() const { return query->getColumnCount(); }
+
+        inline const char *get_column_name(int index) const { return query->getColumnName(index); }
+
+        inline SQLite::Column get_column(int index) const { return query->getColumn(index); }
+
+        inline bool is_null(int index) const { return get_column(index).isNull(); }
+
+        inline int get_int(int index) const { return get_column(index).getInt(); }
+
+        inline long long get_int64(int index) const { return get_column(index).getInt64(); }
+
+        inline double get_double(int index) const { return get_column(index).getDouble(); }
+
+        inline std::string_view get_text(int index) const {
+            SQLite::Column column = get_column(index);
+            //  getText has to come before getBytes, sqlite may convert the value in place
+            const char *text = column.getText();
+            return {text, static_cast<size_t>(column.getBytes())};
+        }
+
+        inline blob_view get_blob(int index) const {
+            SQLite::Column column = get_column(index);
+            const void *blob = column.getBlob();
+            return {blob, static_cast<size_t>(column.getBytes())};
+        }
+
+        /// @see DBHelper::read_column
+        template<typename T>
+        inline T get(int index) const {
+            T value;
+            read_column(get_column(index), value);
+            return value;
+        }
+
+        /**
+         * @brief decodes the row into a struct mapped with DBHELPER_ROW, members are matched to the result columns by
+         * name once per cursor, a member without a column of its name is read from its position in DBRow order
+         */
+        template<typename T>
+        inline T as() const { return read_row<T>(*query, cursor->resolve<T>()); }
+    };
+
+    class iterator {
+        Cursor *cursor;
+
+    public:
+        explicit iterator(Cursor *cursor) : cursor(cursor) {}
+
+        inline Row operator*() const { return Row(cursor); }
+
+        inline iterator &operator++() {
+            if (!cursor->step())
+                cursor = nullptr;
+            return *this;
+        }
+
+        inline bool operator==(const iterator &other) const { return cursor == other.cursor; }
+
+        inline bool operator!=(const iterator &other) const { return cursor != other.cursor; }
+    };
+
+    explicit Cursor(std::shared_ptr<SQLite::Statement> query) : query(std::move(query)) {}
+
+    Cursor(Cursor &&other) noexcept = default;
+
+    Cursor &operator=(Cursor &&other) noexcept;
+
+    Cursor(const Cursor &) = delete;
+
+    Cursor &operator=(const Cursor &) = delete;
+
+    ~Cursor();
+
+    /// steps to the first row, a cursor can only be iterated once
+    inline iterator begin() { return iterator(step() ? this : nullptr); }
+
+    inline iterator end() { return iterator(nullptr); }
+
+    /// @return false if the statement couldn't be prepared
+    inline explicit operator bool() const { return static_cast<bool>(query); }
+
+    inline SQLite::Statement &statement() { return *query; }
+
+    /**
+     * @brief steps to the next row, errors are written to std::cerr and end the iteration
+     * @return false once there are no more rows
+     */
+    bool step();
+
+private:
+    void release();
+
+    /// @return row_indexes for <b>T</b>, resolved from the column names of the statement on the first call
+    template<typename T>
+    inline const std::vector<int> &resolve();
 };
 
 #undef private
@@ -5,13 +5,33 @@
 #pragma once
 
 #include <SQLiteCpp/Database.h>
+#include <sqlite3.h>
 
 
 template<typename T>
 bool DBHelper::exists(const std::string &table_name, const std::string &column, T value) {
-    SQLite::Column c = database->execAndGet(mutl::concatenate(
-            "SELECT EXISTS(SELECT 1 FROM ", table_name, " WHERE ", column, "=\"", value, "\" LIMIT 1)"));
-    return c.getInt();
+    try {
+        if (db_connection && !db_connection->bloom_filters.empty()) {
+            if (column_filter *filter = bloom_filter(table_name, column)) {
+                std::optional<std::string> key = bloom_key(value, filter->integer_affinity);
+                //  the filter only knows the writes of this connection, the check for others costs a statement step
+                //  and is left for values it doesn't have
+                if (key && !filter->filter.might_contain(*key) && bloom_filter_current(*filter))
+                    return false;
+            }
+        }
+
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT EXISTS(SELECT 1 FROM ", table_name, " WHERE ", column, "=? LIMIT 1)"));
+        bind_value(*query, 1, value);
+        query->executeStep();
+        bool result = query->getColumn(0).getInt();
+        query->reset();
+        return result;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::exists -> " << e.what() << std::endl;
+        return false;
+    }
 }
 
 template<typename ...Args>
@@ -40,28 +60,25 @@ inline std::string DBHelper::create(const std::string &table_name, Args &&...arg
 
 template<typename ...Args>
 inline std::string DBHelper::insert(const std::string &table_name, Args ...args) {
-    try {
-        constexpr size_t n = sizeof...(args);
-        constexpr size_t half_n = n / 2;
-        if (n % 2 != 0 || n == 0) {
-            std::cerr << "DBHelper::insert -> " << "needs even amount of arguments\n";
+    constexpr size_t n = sizeof...(args);
+    constexpr size_t half_n = n / 2;
+    if constexpr (n % 2 != 0 || n == 0) {
+        std::cerr << "DBHelper::insert -> " << "needs even amount of arguments\n";
+        return {};
+    } else {
+        try {
+            const std::string &sql = insert_sql(table_name, args...);
+
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            typename integer_range_generate<std::size_t, half_n, n - 1, 1>::type indices;
+            bind(*query, indices, std::forward_as_tuple(std::forward<Args>(args)...));
+            query->exec();
+
+            return sql;
+        } catch (SQLite::Exception &e) {
+            std::cerr << "DBHelper::insert -> " << e.what() << std::endl;
             return {};
         }
-
-        std::string sql = mutl::concatenate(
-                "INSERT INTO ", table_name,
-                " (", mutl::format_with_comma<0, half_n - 1>(args...),
-                ") VALUES (", intersected_questionmarks(half_n), ")");
-
-        SQLite::Statement query(*database, sql);
-        typename integer_range_generate<std::size_t, half_n, n - 1, 1>::type indices;
-        bind(query, indices, std::forward_as_tuple(std::forward<Args>(args)...));
-        query.exec();
-
-        return sql;
-    } catch (SQLite::Exception &e) {
-        std::cerr << "DBHelper::insert -> " << e.what() << std::endl;
-        return {};
     }
 }
 
@@ -69,14 +86,14 @@ template<typename ...Args>
 inline std::string
 DBHelper::insert(const std::string &table_name, std::initializer_list<std::string> columns, Args...values) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "INSERT INTO ", table_name,
                 " (", mutl::format_with_comma(columns),
                 ") VALUES (", intersected_questionmarks(sizeof...(values)), ")"));
-        SQLite::bind(query, values...);
-        query.exec();
+        SQLite::bind(*query, values...);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::insert -> " << e.what() << std::endl;
         return {};
@@ -90,17 +107,97 @@ DBHelper::insert(const std::string &table_name, const std::vector<std::pair<std:
         if (columns_values.empty())
             throw std::invalid_argument("empty vector");
 
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "INSERT INTO ", table_name,
                 " (", mutl::format_param_with_comma<0>(columns_values),
                 ") VALUES (", intersected_questionmarks(columns_values.size()), ")"));
 
         int i = 0;
         for (auto [column, value]: columns_values)
-            query.bind(++i, value);
-        query.exec();
+            query->bind(++i, value);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::insert -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Rows>
+inline size_t
+DBHelper::insert_many(const std::string &table_name, const std::vector<std::string> &columns, const Rows &rows) {
+    using row_type = std::decay_t<decltype(*std::begin(rows))>;
+    if (columns.size() != row_size<row_type>()) {
+        std::cerr << "DBHelper::insert_many -> " << "row size doesn't match the amount of columns\n";
+        return 0;
+    }
+
+    const size_t row_count = std::size(rows);
+    if (row_count == 0)
+        return 0;
+
+    try {
+        const size_t chunk_size = std::min(row_count, max_rows_per_statement(columns.size()));
+        const int column_count = static_cast<int>(columns.size());
+
+        Savepoint savepoint(*this);
+        if (!savepoint.is_active())
+            return 0;
+
+        std::shared_ptr<SQLite::Statement> query = prepare(multi_row_insert_sql(table_name, columns, chunk_size));
+        size_t statement_rows = chunk_size;
+        size_t in_chunk = 0;
+        size_t remaining = row_count;
+        for (const auto &row: rows) {
+            bind_row(*query, static_cast<int>(in_chunk) * column_count, row);
+            if (++in_chunk < statement_rows)
+                continue;
+
+            query->exec();
+            remaining -= in_chunk;
+            in_chunk = 0;
+            if (remaining == 0)
+                break;
+
+            if (remaining < chunk_size) {
+                statement_rows = remaining;
+                query = prepare(multi_row_insert_sql(table_name, columns, statement_rows));
+                continue;
+            }
+            query->reset();
+        }
+
+        //  the outermost savepoint commits on release, a failed one is rolled back by the guard
+        if (!savepoint.release())
+            return 0;
+        return row_count;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::insert_many -> " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+template<typename Rows>
+inline size_t
+DBHelper::insert_many(const std::string &table_name, const Rows &rows) {
+    using row_type = std::decay_t<decltype(*std::begin(rows))>;
+    static_assert(is_db_row_v<row_type>, "rows have to be mapped with DBHELPER_ROW, use the overload taking columns");
+
+    return insert_many(table_name, row_columns<row_type>(), rows);
+}
+
+template<typename Row>
+inline std::enable_if_t<is_db_row_v<Row>, std::string>
+DBHelper::insert(const std::string &table_name, const Row &row) {
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "INSERT INTO ", table_name,
+                " (", DBRow<Row>::columns,
+                ") VALUES (", intersected_questionmarks(row_size<Row>()), ")"));
+        bind_row(*query, 0, row);
+        query->exec();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::insert -> " << e.what() << std::endl;
         return {};
@@ -112,13 +209,13 @@ inline std::string
 DBHelper::dele(const std::string &table_name, const std::tuple<Col, Op, Val> &condition) {
     try {
         auto [column, op, value] = condition;
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "DELETE FROM ", table_name,
                 " WHERE ", column, op, "?"));
-        SQLite::bind(query, value);
-        query.exec();
+        SQLite::bind(*query, value);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::dele -> " << e.what() << std::endl;
         return {};
@@ -129,12 +226,12 @@ template<typename T>
 inline std::string
 DBHelper::dele(const std::string &table_name, const std::string &column, const std::string &op, const T &value) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "DELETE FROM ", table_name,
                 " WHERE ", column, op, "?"));
-        SQLite::bind(query, value);
-        query.exec();
-        return query.getQuery();
+        SQLite::bind(*query, value);
+        query->exec();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::dele -> " << e.what() << std::endl;
         return {};
@@ -145,13 +242,13 @@ template<typename T>
 inline std::string
 DBHelper::dele(const std::string &table_name, const std::string &column, const T &value) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "DELETE FROM ", table_name,
                 " WHERE ", column, "=?"));
-        SQLite::bind(query, value);
-        query.exec();
+        SQLite::bind(*query, value);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::dele -> " << e.what() << std::endl;
         return {};
@@ -162,15 +259,15 @@ template<typename Col, typename Op, typename Val>
 inline std::string
 DBHelper::dele(const std::string &table_name, std::vector<std::tuple<Col, Op, Val>> &conditions) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
                 "DELETE FROM ", table_name,
                 " WHERE ", format_into_question_mark_equation_logic(conditions)));
 
         for (int i = 0; i < conditions.size(); ++i)
-            query.bind(i + 1, std::get<2>(conditions.at(i)));
-        query.exec();
+            query->bind(i + 1, std::get<2>(conditions.at(i)));
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::dele -> " << e.what() << std::endl;
         return {};
@@ -181,13 +278,15 @@ template<typename T>
 inline SQLite::Column
 DBHelper::get(const std::string &table_name, const std::string &condition_column, const T &condition_value) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        //  the returned column keeps its statement stepped onto the row, a cached one would hold its read lock
+        //  until the same sql runs again
+        std::shared_ptr<SQLite::Statement> query = compile(mutl::concatenate(
                 "SELECT * FROM ", table_name,
                 " WHERE ", condition_column, "=?"));
-        SQLite::bind(query, condition_value);
-        query.executeStep();
+        SQLite::bind(*query, condition_value);
+        query->executeStep();
 
-        return query.getColumn(0);
+        return query->getColumn(0);
     } catch (SQLite::Exception &e) {
         throw std::invalid_argument("DBHelper::get -> " + (std::string) e.what());
     }
@@ -198,14 +297,16 @@ inline SQLite::Column
 DBHelper::get(const std::string &table_name, const std::string &column,
               const std::string &condition_column, const T &condition_value) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        //  the returned column keeps its statement stepped onto the row, a cached one would hold its read lock
+        //  until the same sql runs again
+        std::shared_ptr<SQLite::Statement> query = compile(mutl::concatenate(
                 "SELECT ", column,
                 " FROM ", table_name,
                 " WHERE ", condition_column, "=?"));
-        SQLite::bind(query, condition_value);
-        query.executeStep();
+        SQLite::bind(*query, condition_value);
+        query->executeStep();
 
-        return query.getColumn(0);
+        return query->getColumn(0);
     } catch (SQLite::Exception &e) {
         throw std::invalid_argument("DBHelper::get -> " + (std::string) e.what());
     }
@@ -217,14 +318,16 @@ DBHelper::get(const std::string &table_name, const std::string &column,
               const std::tuple<Col, Op, Val> &condition) {
     try {
         auto [col, op, val] = condition;
-        SQLite::Statement query(*database, mutl::concatenate(
+        //  the returned column keeps its statement stepped onto the row, a cached one would hold its read lock
+        //  until the same sql runs again
+        std::shared_ptr<SQLite::Statement> query = compile(mutl::concatenate(
                 "SELECT ", column,
                 " FROM ", table_name,
                 " WHERE ", col, op, "?"));
-        SQLite::bind(query, val);
-        query.executeStep();
+        SQLite::bind(*query, val);
+        query->executeStep();
 
-        return query.getColumn(0);
+        return query->getColumn(0);
     } catch (SQLite::Exception &e) {
         throw std::invalid_argument("DBHelper::get -> " + (std::string) e.what());
     }
@@ -235,21 +338,144 @@ inline SQLite::Column
 DBHelper::get(const std::string &table_name, const std::string &column,
               const std::vector<std::tuple<Col, Op, Val>> &conditions) {
     try {
-        SQLite::Statement query(*database, mutl::concatenate(
+        //  the returned column keeps its statement stepped onto the row, a cached one would hold its read lock
+        //  until the same sql runs again
+        std::shared_ptr<SQLite::Statement> query = compile(mutl::concatenate(
                 "SELECT ", column,
                 " FROM ", table_name,
                 " WHERE ", format_into_question_mark_equation_logic(conditions)));
 
         for (int i = 0; i < conditions.size(); ++i)
-            query.bind(i + 1, std::get<2>(conditions.at(i)));
-        query.executeStep();
+            query->bind(i + 1, std::get<2>(conditions.at(i)));
+        query->executeStep();
 
-        return query.getColumn(0);
+        return query->getColumn(0);
     } catch (SQLite::Exception &e) {
         throw std::invalid_argument("DBHelper::get -> " + (std::string) e.what());
     }
 }
 
+template<typename V, typename T>
+inline std::optional<V>
+DBHelper::try_get(const std::string &table_name, const std::string &column,
+                  const std::string &condition_column, const T &condition_value) {
+    try {
+        std::string sql = mutl::concatenate(
+                "SELECT ", column,
+                " FROM ", table_name,
+                " WHERE ", condition_column, "=?");
+        return read_through<std::optional<V>>(table_name, sql, [&] {
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            bind_value(*query, 1, condition_value);
+            return read_first<V>(*query);
+        }, condition_value);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::try_get -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename V, typename Col, typename Op, typename Val>
+inline std::optional<V>
+DBHelper::try_get(const std::string &table_name, const std::string &column, const std::tuple<Col, Op, Val> &condition) {
+    try {
+        auto [col, op, val] = condition;
+        std::string sql = mutl::concatenate(
+                "SELECT ", column,
+                " FROM ", table_name,
+                " WHERE ", col, op, "?");
+        return read_through<std::optional<V>>(table_name, sql, [&] {
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            bind_value(*query, 1, val);
+            return read_first<V>(*query);
+        }, val);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::try_get -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename V, typename Col, typename Op, typename Val>
+inline std::optional<V>
+DBHelper::try_get(const std::string &table_name, const std::string &column,
+                  const std::vector<std::tuple<Col, Op, Val>> &conditions) {
+    try {
+        std::string sql = mutl::concatenate(
+                "SELECT ", column,
+                " FROM ", table_name,
+                " WHERE ", format_into_question_mark_equation_logic(conditions));
+        return read_through<std::optional<V>>(table_name, sql, [&] {
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            for (int i = 0; i < conditions.size(); ++i)
+                bind_value(*query, i + 1, std::get<2>(conditions.at(i)));
+            return read_first<V>(*query);
+        }, conditions);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::try_get -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename V, typename K>
+inline std::unordered_map<K, V>
+DBHelper::get_many(const std::string &table_name, const std::string &column, const std::string &key_column,
+                   const std::vector<K> &keys) {
+    std::unordered_map<K, V> values;
+    if (keys.empty())
+        return values;
+
+    try {
+        //  placeholder counts go up in powers of two, lists of similar length share one cached statement
+        const size_t max_chunk_size = max_rows_per_statement(1);
+        size_t chunk_size = 1;
+        while (chunk_size < keys.size() && chunk_size < max_chunk_size)
+            chunk_size *= 2;
+        chunk_size = std::min(chunk_size, max_chunk_size);
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT ", key_column, ", ", column,
+                " FROM ", table_name,
+                " WHERE ", key_column, " IN (", intersected_questionmarks(static_cast<int>(chunk_size)), ")"));
+
+        values.reserve(keys.size());
+        for (size_t begin = 0; begin < keys.size(); begin += chunk_size) {
+            //  a repeated key doesn't change the result and fills the chunk up to the size of the statement
+            for (size_t i = 0; i < chunk_size; ++i)
+                bind_value(*query, static_cast<int>(i) + 1, keys[std::min(begin + i, keys.size() - 1)]);
+
+            while (query->executeStep()) {
+                K key;
+                read_column(query->getColumn(0), key);
+                if (values.find(key) != values.end())
+                    continue;
+                read_column(query->getColumn(1), values[key]);
+            }
+            query->reset();
+        }
+        return values;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::get_many -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename V, typename K>
+inline std::vector<std::optional<V>>
+DBHelper::get_many_aligned(const std::string &table_name, const std::string &column, const std::string &key_column,
+                           const std::vector<K> &keys) {
+    std::unordered_map<K, V> values = get_many<V>(table_name, column, key_column, keys);
+
+    std::vector<std::optional<V>> aligned;
+    aligned.reserve(keys.size());
+    for (const K &key: keys) {
+        auto value = values.find(key);
+        if (value == values.end())
+            aligned.emplace_back();
+        else
+            aligned.emplace_back(value->second);
+    }
+    return aligned;
+}
+
 template<typename Col, typename Op, typename Val>
 inline std::shared_ptr<SQLite::Statement>
 DBHelper::select(const std::string &table_name,
@@ -260,8 +486,7 @@ DBHelper::select(const std::string &table_name,
                 "SELECT * FROM ", table_name,
                 " WHERE ", column, op, "?");
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
         SQLite::bind(*query, value);
 
         return query;
@@ -281,8 +506,7 @@ DBHelper::select(const std::string &table_name,
                 "SELECT * FROM ", table_name,
                 conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions));
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
 
         for (int i = 0; i < conditions.size(); ++i)
             query->bind(i + 1, std::get<2>(conditions.at(i)));
@@ -306,8 +530,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 " WHERE ", column, op, "?");
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
         SQLite::bind(*query, value);
 
         return query;
@@ -329,8 +552,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 " WHERE ", column, op, "?");
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
         SQLite::bind(*query, value);
 
         return query;
@@ -352,8 +574,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 " WHERE ", column, op, "?");
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
         SQLite::bind(*query, value);
 
         return query;
@@ -375,8 +596,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions));
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
 
         for (int i = 0; i < conditions.size(); ++i)
             query->bind(i + 1, std::get<2>(conditions.at(i)));
@@ -400,8 +620,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions));
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
 
         for (int i = 0; i < conditions.size(); ++i)
             query->bind(i + 1, std::get<2>(conditions.at(i)));
@@ -425,8 +644,7 @@ DBHelper::select(const std::string &table_name,
                 " FROM ", table_name,
                 conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions));
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
 
         for (int i = 0; i < conditions.size(); ++i)
             query->bind(i + 1, std::get<2>(conditions.at(i)));
@@ -438,6 +656,170 @@ DBHelper::select(const std::string &table_name,
     }
 }
 
+template<typename Row>
+inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+DBHelper::select(const std::string &table_name) {
+    try {
+        std::string sql = mutl::concatenate(
+                "SELECT ", DBRow<Row>::columns,
+                " FROM ", table_name);
+        return read_through<std::vector<Row>>(table_name, sql, [&] {
+            return read_rows<Row>(*prepare(sql));
+        });
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Row, typename Col, typename Op, typename Val>
+inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+DBHelper::select(const std::string &table_name, const std::tuple<Col, Op, Val> &condition) {
+    try {
+        auto [column, op, value] = condition;
+        std::string sql = mutl::concatenate(
+                "SELECT ", DBRow<Row>::columns,
+                " FROM ", table_name,
+                " WHERE ", column, op, "?");
+        return read_through<std::vector<Row>>(table_name, sql, [&] {
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            bind_value(*query, 1, value);
+            return read_rows<Row>(*query);
+        }, value);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Row, typename Col, typename Op, typename Val>
+inline std::enable_if_t<is_db_row_v<Row>, std::vector<Row>>
+DBHelper::select(const std::string &table_name, const std::vector<std::tuple<Col, Op, Val>> &conditions) {
+    try {
+        std::string sql = mutl::concatenate(
+                "SELECT ", DBRow<Row>::columns,
+                " FROM ", table_name,
+                conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions));
+        return read_through<std::vector<Row>>(table_name, sql, [&] {
+            std::shared_ptr<SQLite::Statement> query = prepare(sql);
+            for (int i = 0; i < conditions.size(); ++i)
+                bind_value(*query, i + 1, std::get<2>(conditions.at(i)));
+            return read_rows<Row>(*query);
+        }, conditions);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Col, typename Op, typename Val>
+inline std::shared_ptr<SQLite::Statement>
+DBHelper::select(const std::string &table_name, const std::tuple<Col, Op, Val> &condition, const order_by &ordering) {
+    try {
+        auto [column, op, value] = condition;
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT * FROM ", table_name,
+                " WHERE ", column, op, "?",
+                format_order_by(ordering)));
+        bind_value(*query, 1, value);
+        bind_order_by(*query, 2, ordering);
+
+        return query;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Col, typename Op, typename Val>
+inline std::shared_ptr<SQLite::Statement>
+DBHelper::select(const std::string &table_name, const std::vector<std::tuple<Col, Op, Val>> &conditions,
+                 const order_by &ordering) {
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT * FROM ", table_name,
+                conditions.empty() ? "" : " WHERE ", format_into_question_mark_equation_logic(conditions),
+                format_order_by(ordering)));
+        int index = 1;
+        for (const auto &condition: conditions)
+            bind_value(*query, index++, std::get<2>(condition));
+        bind_order_by(*query, index, ordering);
+
+        return query;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Row, typename Col, typename Op, typename Val>
+inline std::enable_if_t<is_db_row_v<Row>, DBHelper::page<Row>>
+DBHelper::select_page(const std::string &table_name, const std::string &key_column, size_t page_size,
+                      const std::string &token, const std::vector<std::tuple<Col, Op, Val>> &conditions,
+                      direction order) {
+    page<Row> result;
+    if (page_size == 0)
+        return result;
+
+    try {
+        const char *after = order == ASC ? ">" : "<";
+        const char *sort = order == ASC ? " ASC" : " DESC";
+        std::string where = format_into_question_mark_equation_logic(conditions);
+
+        //  one row more than asked for tells whether there is a next page
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT rowid, ", key_column, ", ", DBRow<Row>::columns,
+                " FROM ", table_name,
+                " WHERE ", where, where.empty() ? "" : " AND ", key_column, " IS NOT NULL",
+                token.empty() ? "" : mutl::concatenate(" AND ", key_column, after, "=? AND (",
+                                                       key_column, after, "? OR rowid", after, "?)"),
+                " ORDER BY ", key_column, sort, ", rowid", sort,
+                " LIMIT ?"));
+
+        int index = 1;
+        for (const auto &condition: conditions)
+            bind_value(*query, index++, std::get<2>(condition));
+        if (!token.empty()) {
+            bind_page_token(*query, index, token);
+            index += 3;
+        }
+        query->bind(index, static_cast<int64_t>(page_size) + 1);
+
+        result.rows.reserve(page_size);
+        std::string last_row_token;
+        while (query->executeStep()) {
+            if (result.rows.size() == page_size) {
+                //  the token of the last row only counts if another row follows it
+                result.next_token = std::move(last_row_token);
+                break;
+            }
+            result.rows.push_back(read_row<Row>(*query, 2));
+            if (result.rows.size() == page_size)
+                last_row_token = page_token(*query);
+        }
+        query->reset();
+
+        return result;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select_page -> " << e.what() << std::endl;
+        return {};
+    } catch (std::invalid_argument &e) {
+        std::cerr << "DBHelper::select_page -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename ...Args>
+inline DBHelper::Cursor DBHelper::scan(const std::string &table_name, Args &&...args) {
+    return Cursor(select(table_name, std::forward<Args>(args)...));
+}
+
+template<typename ...Args>
+inline DBHelper::Cursor
+DBHelper::scan(const std::string &table_name, std::initializer_list<std::string> columns, Args &&...args) {
+    return Cursor(select(table_name, columns, std::forward<Args>(args)...));
+}
+
 template<typename T, typename ...Args>
 inline std::string
 DBHelper::update(const std::string &table_name,
@@ -448,17 +830,15 @@ DBHelper::update(const std::string &table_name,
         typename integer_range_generate<std::size_t, 0, n - 2, 2>::type columns;
         typename integer_range_generate<std::size_t, 1, n - 1, 2>::type values;
 
-        std::string sql = mutl::concatenate(
-                "UPDATE ", table_name,
-                " SET ", format_into_question_mark_equation_comma(columns, std::forward_as_tuple(args...)),
-                " WHERE ", condition_column, "=?");
+        const std::string &sql = update_sql(table_name, columns, std::forward_as_tuple(args...),
+                                            condition_column, "=");
 
-        SQLite::Statement query(*database, sql);
-        bind(query, values, std::forward_as_tuple(std::forward<Args>(args)...));
-        query.bind((n / 2) + 1, condition_value);
-        query.exec();
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
+        bind(*query, values, std::forward_as_tuple(std::forward<Args>(args)...));
+        query->bind((n / 2) + 1, condition_value);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::update -> " << e.what() << std::endl;
         return {};
@@ -474,15 +854,13 @@ DBHelper::update(const std::string &table_name, const std::tuple<Col, Op, Val> &
         typename integer_range_generate<std::size_t, 1, n - 1, 2>::type values;
 
         auto [col, op, val] = condition;
-        SQLite::Statement query(*database, mutl::concatenate(
-                "UPDATE ", table_name,
-                " SET ", format_into_question_mark_equation_comma(columns, std::forward_as_tuple(args...)),
-                " WHERE ", col, op, "?"));
-        bind(query, values, std::forward_as_tuple(std::forward<Args>(args)...));
-        query.bind((n / 2) + 1, val);
-        query.exec();
+        std::shared_ptr<SQLite::Statement> query = prepare(update_sql(table_name, columns, std::forward_as_tuple(args...),
+                                                                      col, op));
+        bind(*query, values, std::forward_as_tuple(std::forward<Args>(args)...));
+        query->bind((n / 2) + 1, val);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::update -> " << e.what() << std::endl;
         return {};
@@ -503,14 +881,36 @@ DBHelper::update(const std::string &table_name, std::vector<std::tuple<std::stri
                 " SET ",
                 format_into_question_mark_equation_comma(columns, std::forward_as_tuple(args...)),
                 " WHERE ", format_into_question_mark_equation_logic(conditions));
-        SQLite::Statement query(*database, sql);
-        bind(query, values, std::forward_as_tuple(args...));
+        std::shared_ptr<SQLite::Statement> query = prepare(sql);
+        bind(*query, values, std::forward_as_tuple(args...));
         int q = (n / 2) + 1;
         for (int i = 0; i < conditions.size(); ++i)
-            query.bind(q++, std::get<2>(conditions.at(i)));
-        query.exec();
+            query->bind(q++, std::get<2>(conditions.at(i)));
+        query->exec();
+
+        return query->getQuery();
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::update -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+template<typename Row, typename Col, typename Op, typename Val>
+inline std::enable_if_t<is_db_row_v<Row>, std::string>
+DBHelper::update(const std::string &table_name, const std::tuple<Col, Op, Val> &condition, const Row &row) {
+    try {
+        constexpr int n = static_cast<int>(row_size<Row>());
+
+        auto [col, op, val] = condition;
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "UPDATE ", table_name,
+                " SET ", row_question_mark_equation_comma<Row>(),
+                " WHERE ", col, op, "?"));
+        bind_row(*query, 0, row);
+        bind_value(*query, n + 1, val);
+        query->exec();
 
-        return query.getQuery();
+        return query->getQuery();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::update -> " << e.what() << std::endl;
         return {};
@@ -522,6 +922,262 @@ inline std::string DBHelper::as_questionmark(const T &t) {
     return "?";
 }
 
+template<typename Row>
+inline void DBHelper::bind_row(SQLite::Statement &query, int offset, const Row &row) {
+    auto bind_values = [&query, offset](const auto &...values) {
+        int n = offset;
+        (bind_value(query, ++n, values), ...);
+    };
+
+    if constexpr (is_db_row_v<Row>)
+        std::apply(bind_values, DBRow<Row>::tie(row));
+    else
+        std::apply(bind_values, row);
+}
+
+template<typename Row>
+constexpr size_t DBHelper::row_size() {
+    if constexpr (is_db_row_v<Row>)
+        return std::tuple_size_v<decltype(DBRow<Row>::tie(std::declval<Row &>()))>;
+    else
+        return std::tuple_size_v<Row>;
+}
+
+template<typename T>
+inline void DBHelper::bind_value(SQLite::Statement &query, int index, const T &value) {
+    if constexpr (std::is_same_v<T, std::nullptr_t>)
+        query.bind(index);
+    else if constexpr (is_optional<T>::value) {
+        if (value)
+            bind_value(query, index, *value);
+        else
+            query.bind(index);
+    } else if constexpr (std::is_same_v<T, bool>)
+        query.bind(index, static_cast<int32_t>(value));
+    else if constexpr (std::is_integral_v<T> && sizeof(T) < sizeof(int64_t))
+        query.bind(index, static_cast<int32_t>(value));
+    else if constexpr (std::is_integral_v<T>)
+        query.bind(index, static_cast<int64_t>(value));
+    else if constexpr (std::is_floating_point_v<T>)
+        query.bind(index, static_cast<double>(value));
+    else if constexpr (std::is_same_v<T, std::vector<char>> || std::is_same_v<T, std::vector<unsigned char>>)
+        query.bind(index, static_cast<const void *>(value.data()), static_cast<int>(value.size()));
+    else
+        query.bind(index, value);
+}
+
+template<typename T>
+inline void DBHelper::read_column(const SQLite::Column &column, T &value) {
+    if constexpr (is_optional<T>::value) {
+        if (column.isNull()) {
+            value.reset();
+        } else {
+            typename T::value_type inner;
+            read_column(column, inner);
+            value = std::move(inner);
+        }
+    } else if constexpr (std::is_same_v<T, bool>)
+        value = column.getInt() != 0;
+    else if constexpr (std::is_integral_v<T> && sizeof(T) < sizeof(int64_t))
+        value = static_cast<T>(column.getInt());
+    else if constexpr (std::is_integral_v<T>)
+        value = static_cast<T>(column.getInt64());
+    else if constexpr (std::is_floating_point_v<T>)
+        value = static_cast<T>(column.getDouble());
+    else if constexpr (std::is_same_v<T, std::string>)
+        value = column.getString();
+    else if constexpr (std::is_same_v<T, std::vector<char>> || std::is_same_v<T, std::vector<unsigned char>>) {
+        auto blob = static_cast<const typename T::value_type *>(column.getBlob());
+        value.assign(blob, blob + column.getBytes());
+    } else
+        static_assert(!sizeof(T), "DBHelper::read_column -> unsupported column type");
+}
+
+template<typename T>
+inline void DBHelper::read_column(sqlite3_stmt *statement, int index, T &value) {
+    if constexpr (is_optional<T>::value) {
+        if (sqlite3_column_type(statement, index) == SQLITE_NULL) {
+            value.reset();
+        } else {
+            typename T::value_type inner;
+            read_column(statement, index, inner);
+            value = std::move(inner);
+        }
+    } else if constexpr (std::is_same_v<T, bool>)
+        value = sqlite3_column_int(statement, index) != 0;
+    else if constexpr (std::is_integral_v<T> && sizeof(T) < sizeof(int64_t))
+        value = static_cast<T>(sqlite3_column_int(statement, index));
+    else if constexpr (std::is_integral_v<T>)
+        value = static_cast<T>(sqlite3_column_int64(statement, index));
+    else if constexpr (std::is_floating_point_v<T>)
+        value = static_cast<T>(sqlite3_column_double(statement, index));
+    else if constexpr (std::is_same_v<T, std::string>) {
+        //  the text has to be asked for before its size, sqlite may convert the value in place
+        const auto *text = reinterpret_cast<const char *>(sqlite3_column_text(statement, index));
+        value.assign(text ? text : "", static_cast<size_t>(sqlite3_column_bytes(statement, index)));
+    } else if constexpr (std::is_same_v<T, std::vector<char>> || std::is_same_v<T, std::vector<unsigned char>>) {
+        auto blob = static_cast<const typename T::value_type *>(sqlite3_column_blob(statement, index));
+        value.assign(blob, blob + sqlite3_column_bytes(statement, index));
+    } else
+        static_assert(!sizeof(T), "DBHelper::read_column -> unsupported column type");
+}
+
+template<typename R, typename Load, typename ...Values>
+inline R DBHelper::read_through(const std::string &table_name, std::string key, Load &&load, const Values &...values) {
+    if (result_cache_capacity == 0)
+        return load();
+
+    validate_result_cache();
+    key.push_back('\0');
+    (append_cache_key(key, values), ...);
+
+    auto it = result_cache_index.find(key);
+    if (it != result_cache_index.end()) {
+        cached_result &entry = *it->second;
+        if (*entry.table_generation == entry.generation) {
+            //  the same sql may have been read into another type, that one is replaced below
+            if (const R *value = std::any_cast<R>(&entry.value)) {
+                ++result_stats.hits;
+                result_cache.splice(result_cache.begin(), result_cache, it->second);
+                return *value;
+            }
+        } else
+            ++result_stats.invalidations;
+        result_cache_bytes -= entry.bytes;
+        auto cached = it->second;
+        result_cache_index.erase(it);
+        result_cache.erase(cached);
+    }
+
+    ++result_stats.misses;
+    R result = load();
+    size_t bytes = sizeof(cached_result) + key.capacity() + sizeof(R) + heap_size(result);
+    store_result(table_name, std::move(key), result, bytes);
+    return result;
+}
+
+template<typename T>
+inline void DBHelper::append_cache_key(std::string &key, const T &value) {
+    if constexpr (std::is_same_v<T, std::nullptr_t> || std::is_same_v<T, std::nullopt_t>)
+        key.push_back('n');
+    else if constexpr (is_optional<T>::value) {
+        if (value)
+            append_cache_key(key, *value);
+        else
+            key.push_back('n');
+    } else if constexpr (std::is_integral_v<T>) {
+        key.push_back('i');
+        key.append(std::to_string(static_cast<int64_t>(value))).push_back(';');
+    } else if constexpr (std::is_floating_point_v<T>) {
+        //  the exact bits, printing could round two values into one key
+        auto number = static_cast<double>(value);
+        key.push_back('f');
+        key.append(reinterpret_cast<const char *>(&number), sizeof(number));
+    } else if constexpr (std::is_same_v<T, std::vector<char>> || std::is_same_v<T, std::vector<unsigned char>>) {
+        key.push_back('b');
+        key.append(std::to_string(value.size())).push_back(':');
+        key.append(reinterpret_cast<const char *>(value.data()), value.size());
+    } else if constexpr (is_vector<T>::value) {
+        //  the conditions of a where clause, their columns and operators are already part of the sql
+        for (const auto &condition: value)
+            append_cache_key(key, std::get<2>(condition));
+    } else {
+        std::string_view text(value);
+        key.push_back('t');
+        key.append(std::to_string(text.size())).push_back(':');
+        key.append(text);
+    }
+}
+
+template<typename T>
+inline size_t DBHelper::heap_size(const T &value) {
+    if constexpr (std::is_same_v<T, std::string>)
+        return value.capacity() >= sizeof(std::string) ? value.capacity() + 1 : 0;
+    else if constexpr (is_optional<T>::value)
+        return value ? heap_size(*value) : 0;
+    else if constexpr (is_db_row_v<T>)
+        return std::apply([](const auto &...members) { return (size_t{0} + ... + heap_size(members)); },
+                          DBRow<T>::tie(value));
+    else if constexpr (is_vector<T>::value) {
+        size_t bytes = value.capacity() * sizeof(typename T::value_type);
+        if constexpr (!std::is_arithmetic_v<typename T::value_type>)
+            for (const auto &element: value)
+                bytes += heap_size(element);
+        return bytes;
+    } else
+        return 0;
+}
+
+template<typename V>
+inline std::optional<V> DBHelper::read_first(SQLite::Statement &query) {
+    std::optional<V> value;
+    if (query.executeStep() && !query.getColumn(0).isNull()) {
+        value.emplace();
+        read_column(query.getColumn(0), *value);
+    }
+    //  nothing keeps the statement past this call, it's ready for the next caller
+    query.reset();
+    return value;
+}
+
+template<typename Row>
+inline Row DBHelper::read_row(const SQLite::Statement &query, int offset) {
+    Row row{};
+    //  straight from the statement, a SQLite::Column per member costs a shared_ptr copy each
+    sqlite3_stmt *statement = query.getStatement();
+    int i = offset;
+    std::apply([statement, &i](auto &...members) {
+        (read_column(statement, i++, members), ...);
+    }, DBRow<Row>::tie(row));
+    return row;
+}
+
+template<typename Row>
+inline Row DBHelper::read_row(const SQLite::Statement &query, const std::vector<int> &indexes) {
+    Row row{};
+    sqlite3_stmt *statement = query.getStatement();
+    size_t i = 0;
+    std::apply([statement, &indexes, &i](auto &...members) {
+        (read_column(statement, indexes[i++], members), ...);
+    }, DBRow<Row>::tie(row));
+    return row;
+}
+
+template<typename Row>
+inline std::vector<Row> DBHelper::read_rows(SQLite::Statement &query) {
+    std::vector<Row> rows;
+    while (query.executeStep())
+        rows.push_back(read_row<Row>(query));
+    return rows;
+}
+
+template<typename Row>
+inline const std::vector<std::string> &DBHelper::row_columns() {
+    static const std::vector<std::string> columns = [] {
+        std::vector<std::string> result;
+        std::stringstream ss(DBRow<Row>::columns);
+        for (std::string column; std::getline(ss >> std::ws, column, ',');)
+            result.push_back(column);
+        return result;
+    }();
+    return columns;
+}
+
+template<typename Row>
+inline const std::string &DBHelper::row_question_mark_equation_comma() {
+    static const std::string result = [] {
+        std::string columns = DBRow<Row>::columns;
+        std::string sql;
+        for (size_t begin = 0, end; begin < columns.size(); begin = end + 2) {
+            end = std::min(columns.find(", ", begin), columns.size());
+            sql.append(columns, begin, end - begin).append("=?, ");
+        }
+        sql.resize(sql.size() - 2);
+        return sql;
+    }();
+    return result;
+}
+
 template<typename Args, size_t... indexes>
 inline void
 DBHelper::bind(SQLite::Statement &query, integer_pack<size_t, indexes...>, Args &&args) {
@@ -547,6 +1203,75 @@ DBHelper::format_into_question_mark_equation_logic(const std::vector<std::tuple<
     return ss.str();
 }
 
+template<typename Args, size_t... indexes, typename ...Extra>
+inline bool
+DBHelper::generated_sql::matches(integer_pack<size_t, indexes...>, const Args &args, const Extra &...extra) const {
+    if (sql.empty() || key.size() != sizeof...(indexes) + sizeof...(extra))
+        return false;
+
+    size_t i = 0;
+    return ((key[i++] == as_text(std::get<indexes>(args))) && ...) && ((key[i++] == as_text(extra)) && ...);
+}
+
+template<typename Args, size_t... indexes, typename ...Extra>
+inline const std::string &
+DBHelper::generated_sql::assign(std::string generated, integer_pack<size_t, indexes...>, const Args &args,
+                                const Extra &...extra) {
+    key.clear();
+    (key.emplace_back(as_text(std::get<indexes>(args))), ...);
+    (key.emplace_back(as_text(extra)), ...);
+    sql = std::move(generated);
+    return sql;
+}
+
+template<size_t slots>
+template<typename Generate, typename Args, size_t... indexes, typename ...Extra>
+inline const std::string &
+DBHelper::generated_sql_cache<slots>::get(const Generate &generate, integer_pack<size_t, indexes...> columns,
+                                          const Args &args, const Extra &...extra) {
+    for (generated_sql &entry: entries)
+        if (entry.matches(columns, args, extra...))
+            return entry.sql;
+
+    generated_sql &oldest = entries[next];
+    next = (next + 1) % slots;
+    return oldest.assign(generate(), columns, args, extra...);
+}
+
+template<typename T>
+inline auto DBHelper::as_text(const T &t) {
+    if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        return std::string_view(t);
+    else
+        return mutl::concatenate(t);
+}
+
+template<typename ...Args>
+inline const std::string &DBHelper::insert_sql(const std::string &table_name, const Args &...args) {
+    constexpr size_t half_n = sizeof...(args) / 2;
+    typename integer_range_generate<std::size_t, 0, half_n - 1, 1>::type columns;
+    auto arguments = std::forward_as_tuple(args...);
+
+    static thread_local generated_sql_cache<4> cached;
+    return cached.get([&] {
+        return mutl::concatenate("INSERT INTO ", table_name,
+                                 " (", mutl::format_with_comma<0, half_n - 1>(args...),
+                                 ") VALUES (", question_marks<half_n>::view(), ")");
+    }, columns, arguments, table_name);
+}
+
+template<typename Args, size_t... indexes, typename ...Where>
+inline const std::string &
+DBHelper::update_sql(const std::string &table_name, integer_pack<size_t, indexes...> columns, const Args &args,
+                     const Where &...where) {
+    static thread_local generated_sql_cache<4> cached;
+    return cached.get([&] {
+        return mutl::concatenate("UPDATE ", table_name,
+                                 " SET ", format_into_question_mark_equation_comma(columns, args),
+                                 " WHERE ", where..., "?");
+    }, columns, args, table_name, where...);
+}
+
 template<typename Args, size_t... indexes>
 std::string DBHelper::format_into_question_mark_equation_comma(integer_pack<size_t, indexes...>, Args &&args) {
     std::stringstream ss;
@@ -555,4 +1280,43 @@ std::string DBHelper::format_into_question_mark_equation_comma(integer_pack<size
     result.pop_back();
     result.pop_back();
     return result;
-}
\ No newline at end of file
+}
+
+template<typename T>
+inline std::optional<std::string> DBHelper::bloom_key(const T &value, bool integer_affinity) {
+    if constexpr (is_optional<T>::value) {
+        if (!value)
+            return {};
+        return bloom_key(*value, integer_affinity);
+    } else if constexpr (std::is_integral_v<T>)
+        return std::to_string(static_cast<long long>(value));
+    else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        //  numeric text compared against an INTEGER column is converted first, "07" finds 7
+        if (integer_affinity)
+            return {};
+        return std::string(std::string_view(value));
+    } else
+        return {};
+}
+
+template<typename T>
+inline const std::vector<int> &DBHelper::Cursor::resolve() {
+    const std::vector<std::string> &columns = row_columns<T>();
+    if (row_indexes_of == &columns)
+        return row_indexes;
+
+    //  SELECT * returns the columns in table order, which needn't be the order of the members
+    row_indexes.clear();
+    const int count = query->getColumnCount();
+    for (const std::string &column: columns) {
+        int index = static_cast<int>(row_indexes.size());
+        for (int i = 0; i < count; ++i)
+            if (sqlite3_stricmp(query->getColumnName(i), column.c_str()) == 0) {
+                index = i;
+                break;
+            }
+        row_indexes.push_back(index);
+    }
+    row_indexes_of = &columns;
+    return row_indexes;
+}
@@ -0,0 +1,181 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "DBHelper.h"
+
+/**
+ * @brief shares one database file between threads\n
+ * opens one writer and <b>reader_count</b> reader connections in WAL mode, every connection is used by one thread at a
+ * time through a Lease, select/get/exists are routed to a free reader and insert/update/dele/create to the writer
+ * @example
+ * @code
+ * DBHelperPool pool("/home/username/.local/share/ProjectName/database.db3", 8);
+ * pool.insert("table_name", "id", 1);
+ *
+ * //  from any thread
+ * auto query = pool.select("table_name", std::make_tuple("id", "=", 1));
+ * while (query->executeStep())
+ *     int id = query->getColumn(0).getInt();
+ * @endcode
+ */
+class DBHelperPool {
+    std::unique_ptr<DBHelper> writer_helper;
+    std::vector<std::unique_ptr<DBHelper>> readers;
+
+    std::mutex mutex;
+    std::condition_variable released;
+    std::vector<DBHelper *> idle_readers;
+    bool writer_busy = false;
+
+public:
+    /**
+     * @brief RAII handle to one pooled connection, gives it back to the pool on destruction\n
+     * statements of the connection still mid-step are reset on the way back, don't step them past the lease
+     */
+    class Lease {
+        DBHelperPool *pool;
+        DBHelper *db_helper;
+        bool writer;
+
+    public:
+        Lease(DBHelperPool *pool, DBHelper *db_helper, bool writer);
+
+        Lease(Lease &&other) noexcept;
+
+        Lease &operator=(Lease &&other) noexcept;
+
+        Lease(const Lease &) = delete;
+
+        Lease &operator=(const Lease &) = delete;
+
+        ~Lease();
+
+        inline DBHelper *operator->() { return db_helper; }
+
+        inline DBHelper &operator*() { return *db_helper; }
+
+    private:
+        void give_back();
+    };
+
+    /**
+     * @brief a result that is only valid while its connection is leased, e.g. a select statement or a get column
+     */
+    template<typename T>
+    class Leased {
+        Lease lease;
+        std::shared_ptr<T> value;
+
+    public:
+        Leased(Lease &&lease, std::shared_ptr<T> value) : lease(std::move(lease)), value(std::move(value)) {}
+
+        inline T *operator->() { return value.get(); }
+
+        inline T &operator*() { return *value; }
+
+        inline explicit operator bool() const { return static_cast<bool>(value); }
+    };
+
+    /**
+     * @param db_path the complete path to the database @example /home/username/.local/share/ProjectName/database.db3
+     * @param reader_count amount of reader connections, at least one is opened
+     * @param opts applied to every connection, the journal mode is always WAL and only set by the writer
+     */
+    explicit DBHelperPool(const std::string &db_path,
+                          size_t reader_count = std::thread::hardware_concurrency(),
+                          DBHelper::options opts = DBHelper::options::of(DBHelper::BALANCED));
+
+    DBHelperPool(const DBHelperPool &) = delete;
+
+    DBHelperPool &operator=(const DBHelperPool &) = delete;
+
+    /// blocks until a reader connection is free
+    Lease reader();
+
+    /// blocks until the writer connection is free
+    Lease writer();
+
+    inline size_t get_reader_count() const { return readers.size(); }
+
+//======================================================================================================================
+
+    bool table_exists(const std::string &table_name);
+
+    bool table_empty(const std::string &table_name);
+
+    long long row_count(const std::string &table_name, DBHelper::count_mode mode = DBHelper::EXACT);
+
+    template<typename T>
+    inline bool exists(const std::string &table_name, const std::string &column, T value);
+
+    /// @see DBHelper::get
+    template<typename ...Args>
+    inline Leased<SQLite::Column> get(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::try_get
+    template<typename V, typename ...Args>
+    inline std::optional<V> try_get(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::get_many
+    template<typename V, typename K>
+    inline std::unordered_map<K, V>
+    get_many(const std::string &table_name, const std::string &column, const std::string &key_column,
+             const std::vector<K> &keys);
+
+    /// @see DBHelper::get_many_aligned
+    template<typename V, typename K>
+    inline std::vector<std::optional<V>>
+    get_many_aligned(const std::string &table_name, const std::string &column, const std::string &key_column,
+                     const std::vector<K> &keys);
+
+    /// @see DBHelper::select
+    template<typename ...Args>
+    inline Leased<SQLite::Statement> select(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::select
+    template<typename ...Args>
+    inline Leased<SQLite::Statement>
+    select(const std::string &table_name, std::initializer_list<std::string> columns, Args &&...args);
+
+//======================================================================================================================
+
+    /// @see DBHelper::create
+    template<typename ...Args>
+    inline std::string create(const std::string &table_name, Args &&...args);
+
+    bool track_row_count(const std::string &table_name);
+
+    bool untrack_row_count(const std::string &table_name);
+
+    std::string drop(const std::string &table_name);
+
+    /// @see DBHelper::insert
+    template<typename ...Args>
+    inline std::string insert(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::insert
+    template<typename ...Args>
+    inline std::string insert(const std::string &table_name, std::initializer_list<std::string> columns, Args...values);
+
+    /// @see DBHelper::insert_many
+    template<typename Rows>
+    inline size_t
+    insert_many(const std::string &table_name, const std::vector<std::string> &columns, const Rows &rows);
+
+    /// @see DBHelper::update
+    template<typename ...Args>
+    inline std::string update(const std::string &table_name, Args &&...args);
+
+    /// @see DBHelper::dele
+    template<typename ...Args>
+    inline std::string dele(const std::string &table_name, Args &&...args);
+};
+
+#include "DBHelperPool.inl"
@@ -0,0 +1,96 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+
+template<typename T>
+inline bool DBHelperPool::exists(const std::string &table_name, const std::string &column, T value) {
+    Lease lease = reader();
+    return lease->exists(table_name, column, value);
+}
+
+template<typename ...Args>
+inline DBHelperPool::Leased<SQLite::Column>
+DBHelperPool::get(const std::string &table_name, Args &&...args) {
+    Lease lease = reader();
+    auto column = std::make_shared<SQLite::Column>(lease->get(table_name, std::forward<Args>(args)...));
+    return {std::move(lease), std::move(column)};
+}
+
+template<typename V, typename ...Args>
+inline std::optional<V> DBHelperPool::try_get(const std::string &table_name, Args &&...args) {
+    Lease lease = reader();
+    return lease->template try_get<V>(table_name, std::forward<Args>(args)...);
+}
+
+template<typename V, typename K>
+inline std::unordered_map<K, V>
+DBHelperPool::get_many(const std::string &table_name, const std::string &column, const std::string &key_column,
+                       const std::vector<K> &keys) {
+    Lease lease = reader();
+    return lease->template get_many<V>(table_name, column, key_column, keys);
+}
+
+template<typename V, typename K>
+inline std::vector<std::optional<V>>
+DBHelperPool::get_many_aligned(const std::string &table_name, const std::string &column,
+                               const std::string &key_column, const std::vector<K> &keys) {
+    Lease lease = reader();
+    return lease->template get_many_aligned<V>(table_name, column, key_column, keys);
+}
+
+template<typename ...Args>
+inline DBHelperPool::Leased<SQLite::Statement>
+DBHelperPool::select(const std::string &table_name, Args &&...args) {
+    Lease lease = reader();
+    std::shared_ptr<SQLite::Statement> query = lease->select(table_name, std::forward<Args>(args)...);
+    return {std::move(lease), std::move(query)};
+}
+
+template<typename ...Args>
+inline DBHelperPool::Leased<SQLite::Statement>
+DBHelperPool::select(const std::string &table_name, std::initializer_list<std::string> columns, Args &&...args) {
+    Lease lease = reader();
+    std::shared_ptr<SQLite::Statement> query = lease->select(table_name, columns, std::forward<Args>(args)...);
+    return {std::move(lease), std::move(query)};
+}
+
+template<typename ...Args>
+inline std::string DBHelperPool::create(const std::string &table_name, Args &&...args) {
+    Lease lease = writer();
+    return lease->create(table_name, std::forward<Args>(args)...);
+}
+
+template<typename ...Args>
+inline std::string DBHelperPool::insert(const std::string &table_name, Args &&...args) {
+    Lease lease = writer();
+    return lease->insert(table_name, std::forward<Args>(args)...);
+}
+
+template<typename ...Args>
+inline std::string
+DBHelperPool::insert(const std::string &table_name, std::initializer_list<std::string> columns, Args...values) {
+    Lease lease = writer();
+    return lease->insert(table_name, columns, values...);
+}
+
+template<typename Rows>
+inline size_t
+DBHelperPool::insert_many(const std::string &table_name, const std::vector<std::string> &columns, const Rows &rows) {
+    Lease lease = writer();
+    return lease->insert_many(table_name, columns, rows);
+}
+
+template<typename ...Args>
+inline std::string DBHelperPool::update(const std::string &table_name, Args &&...args) {
+    Lease lease = writer();
+    return lease->update(table_name, std::forward<Args>(args)...);
+}
+
+template<typename ...Args>
+inline std::string DBHelperPool::dele(const std::string &table_name, Args &&...args) {
+    Lease lease = writer();
+    return lease->dele(table_name, std::forward<Args>(args)...);
+}
@@ -0,0 +1,100 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#pragma once
+
+#include <tuple>
+#include <optional>
+#include <vector>
+#include <type_traits>
+
+/**
+ * @brief maps a struct to the columns of a table, specialize it with DBHELPER_ROW
+ * @example
+ * @code
+ * struct User {
+ *     int id;
+ *     std::string name;
+ *     std::optional<std::string> email;
+ * };
+ * DBHELPER_ROW(User, id, name, email)
+ *
+ * std::vector<User> users = db_helper.select<User>("users", std::make_tuple("id", ">", 10));
+ * db_helper.insert("users", User{1, "name", std::nullopt});
+ * @endcode
+ */
+template<typename T>
+struct DBRow;
+
+template<typename T, typename = void>
+struct is_db_row : std::false_type {
+};
+
+template<typename T>
+struct is_db_row<T, std::void_t<decltype(DBRow<T>::columns)>> : std::true_type {
+};
+
+template<typename T>
+inline constexpr bool is_db_row_v = is_db_row<T>::value;
+
+/// nullable members are declared as std::optional
+template<typename T>
+struct is_optional : std::false_type {
+};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type {
+};
+
+template<typename T>
+struct is_vector : std::false_type {
+};
+
+template<typename T>
+struct is_vector<std::vector<T>> : std::true_type {
+};
+
+#define DBHELPER_EXPAND(x) x
+#define DBHELPER_ROW_MEMBER(member) row.member
+
+#define DBHELPER_FOR_EACH_1(m, x) m(x)
+#define DBHELPER_FOR_EACH_2(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_1(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_3(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_2(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_4(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_3(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_5(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_4(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_6(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_5(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_7(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_6(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_8(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_7(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_9(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_8(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_10(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_9(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_11(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_10(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_12(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_11(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_13(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_12(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_14(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_13(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_15(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_14(m, __VA_ARGS__))
+#define DBHELPER_FOR_EACH_16(m, x, ...) m(x), DBHELPER_EXPAND(DBHELPER_FOR_EACH_15(m, __VA_ARGS__))
+
+#define DBHELPER_FOR_EACH_NAME(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define DBHELPER_FOR_EACH(m, ...) DBHELPER_EXPAND(DBHELPER_FOR_EACH_NAME(__VA_ARGS__,                   \
+        DBHELPER_FOR_EACH_16, DBHELPER_FOR_EACH_15, DBHELPER_FOR_EACH_14, DBHELPER_FOR_EACH_13,         \
+        DBHELPER_FOR_EACH_12, DBHELPER_FOR_EACH_11, DBHELPER_FOR_EACH_10, DBHELPER_FOR_EACH_9,          \
+        DBHELPER_FOR_EACH_8, DBHELPER_FOR_EACH_7, DBHELPER_FOR_EACH_6, DBHELPER_FOR_EACH_5,             \
+        DBHELPER_FOR_EACH_4, DBHELPER_FOR_EACH_3, DBHELPER_FOR_EACH_2, DBHELPER_FOR_EACH_1)(m, __VA_ARGS__))
+
+/**
+ * @brief specializes DBRow for <b>Type</b>, members are listed in column order and named like the columns\n
+ * supports up to 16 members, has to be used in the global namespace
+ */
+#define DBHELPER_ROW(Type, ...)                                                                                 \
+template<>                                                                                                      \
+struct DBRow<Type> {                                                                                            \
+    /** projection used in SELECT and INSERT, built by the preprocessor */                                      \
+    static constexpr const char *columns = #__VA_ARGS__;                                                        \
+                                                                                                                \
+    static inline auto tie(Type &row) { return std::tie(DBHELPER_FOR_EACH(DBHELPER_ROW_MEMBER, __VA_ARGS__)); } \
+                                                                                                                \
+    static inline auto tie(const Type &row) {                                                                   \
+        return std::tie(DBHELPER_FOR_EACH(DBHELPER_ROW_MEMBER, __VA_ARGS__));                                   \
+    }                                                                                                           \
+};
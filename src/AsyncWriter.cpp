@@ -0,0 +1,175 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#include "../include/AsyncWriter.h"
+
+
+AsyncWriter::AsyncWriter(const std::string &db_path) : AsyncWriter(db_path, batching()) {}
+
+AsyncWriter::AsyncWriter(const std::string &db_path, batching limits, const DBHelper::options &opts)
+        : db_helper(std::make_unique<DBHelper>(db_path, opts)), limits(limits), head(&stub), tail(&stub) {
+    this->limits.max_batch_size = std::max<size_t>(this->limits.max_batch_size, 1);
+    worker = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_one();
+    worker.join();
+}
+
+std::future<bool> AsyncWriter::execute(std::function<bool(DBHelper &)> work) {
+    auto *r = new request;
+    r->work = std::move(work);
+    std::future<bool> result = r->done.get_future();
+    push(r);
+    return result;
+}
+
+std::future<bool> AsyncWriter::flush() {
+    //  batches are committed in queue order, a no-op is done once everything before it is
+    return execute([](DBHelper &) { return true; });
+}
+
+AsyncWriter::writer_stats AsyncWriter::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void AsyncWriter::push(request *r) {
+    //  counted first, a pending request the writer thread can't pop yet makes it spin instead of sleep
+    pending.fetch_add(1);
+
+    r->next.store(nullptr, std::memory_order_relaxed);
+    request *previous = head.exchange(r, std::memory_order_acq_rel);
+    //  between the exchange and this store the consumer sees the queue cut short, pop() returns nullptr meanwhile
+    previous->next.store(r, std::memory_order_release);
+
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.notify_one();
+    }
+}
+
+AsyncWriter::request *AsyncWriter::pop() {
+    request *first = tail;
+    request *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+        if (!next)
+            return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+        tail = next;
+        pending.fetch_sub(1);
+        return first;
+    }
+
+    if (first != head.load(std::memory_order_acquire))
+        return nullptr;
+
+    //  first is the last node, put the stub behind it so it can be handed out
+    stub.next.store(nullptr, std::memory_order_relaxed);
+    request *previous = head.exchange(&stub, std::memory_order_acq_rel);
+    previous->next.store(&stub, std::memory_order_release);
+
+    next = first->next.load(std::memory_order_acquire);
+    if (next) {
+        tail = next;
+        pending.fetch_sub(1);
+        return first;
+    }
+    return nullptr;
+}
+
+void AsyncWriter::run() {
+    std::vector<request *> batch;
+    batch.reserve(limits.max_batch_size);
+
+    while (true) {
+        request *r = pop();
+        if (!r) {
+            if (pending.load() > 0) {
+                //  a producer is between its exchange and linking the node
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping = true;
+            queued.wait(lock, [this] { return pending.load() > 0 || stopping; });
+            sleeping = false;
+            if (pending.load() == 0 && stopping)
+                return;
+            continue;
+        }
+
+        batch.push_back(r);
+        auto deadline = std::chrono::steady_clock::now() + limits.max_latency;
+        while (batch.size() < limits.max_batch_size) {
+            if ((r = pop())) {
+                batch.push_back(r);
+                continue;
+            }
+            if (pending.load() > 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (stopping || std::chrono::steady_clock::now() >= deadline)
+                break;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping = true;
+            queued.wait_until(lock, deadline, [this] { return pending.load() > 0 || stopping; });
+            sleeping = false;
+        }
+
+        commit(batch);
+        batch.clear();
+    }
+}
+
+void AsyncWriter::commit(std::vector<request *> &batch) {
+    //  without a transaction every write still goes through on its own, just without sharing the fsync
+    bool in_transaction = db_helper->begin(DBHelper::IMMEDIATE);
+
+    std::vector<bool> written(batch.size());
+    std::vector<std::exception_ptr> errors(batch.size());
+    //  SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM and the like roll the whole transaction back on their own, the writes
+    //  before went with it and the ones after would each commit on their own
+    bool rolled_back = false;
+    for (size_t i = 0; i < batch.size() && !rolled_back; ++i) {
+        try {
+            written[i] = batch[i]->work(*db_helper);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+        rolled_back = in_transaction && !db_helper->in_transaction();
+    }
+
+    bool committed = !rolled_back && (!in_transaction || db_helper->commit());
+    if (!committed && !rolled_back)
+        db_helper->rollback();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.writes += batch.size();
+        ++stats.batches;
+        stats.failed_commits += !committed;
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (errors[i])
+            batch[i]->done.set_exception(errors[i]);
+        else
+            batch[i]->done.set_value(committed && written[i]);
+        delete batch[i];
+    }
+}
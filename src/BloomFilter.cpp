@@ -0,0 +1,59 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include "../include/BloomFilter.h"
+
+
+BloomFilter::BloomFilter(size_t expected_values, double false_positive_rate) {
+    expected_values = std::max<size_t>(expected_values, 1);
+    false_positive_rate = std::clamp(false_positive_rate, 1e-9, 0.5);
+
+    //  optimal size and amount of hashes, m = -n ln(p) / ln(2)^2, k = m / n ln(2)
+    const double ln2 = std::log(2.0);
+    double m = -static_cast<double>(expected_values) * std::log(false_positive_rate) / (ln2 * ln2);
+    bit_count = std::max<size_t>(64, static_cast<size_t>(std::ceil(m / 64.0)) * 64);
+    hash_count = std::clamp(static_cast<int>(std::round(m / static_cast<double>(expected_values) * ln2)), 1, 16);
+    bits.assign(bit_count / 64, 0);
+}
+
+void BloomFilter::add(std::string_view value) {
+    //  double hashing, h1 + i * h2 behaves like k independent hashes
+    uint64_t h1 = std::hash<std::string_view>{}(value);
+    uint64_t h2 = mix(h1) | 1;
+    for (int i = 0; i < hash_count; ++i) {
+        size_t bit = (h1 + i * h2) % bit_count;
+        bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    ++value_count;
+}
+
+bool BloomFilter::might_contain(std::string_view value) const {
+    uint64_t h1 = std::hash<std::string_view>{}(value);
+    uint64_t h2 = mix(h1) | 1;
+    for (int i = 0; i < hash_count; ++i) {
+        size_t bit = (h1 + i * h2) % bit_count;
+        if ((bits[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+            return false;
+    }
+    return true;
+}
+
+void BloomFilter::clear() {
+    std::fill(bits.begin(), bits.end(), 0);
+    value_count = 0;
+}
+
+uint64_t BloomFilter::mix(uint64_t hash) {
+    //  splitmix64 finalizer
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
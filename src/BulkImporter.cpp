@@ -0,0 +1,639 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../include/BulkImporter.h"
+
+
+/// @return the first delimiter, '\n' or '\r' in [p, end), end if there is none
+static const char *find_field_end(const char *p, const char *end, char delimiter) {
+#ifdef __SSE2__
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i returns = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, delimiters), _mm_cmpeq_epi8(block, newlines)),
+                                     _mm_cmpeq_epi8(block, returns));
+        if (int mask = _mm_movemask_epi8(found))
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; ++p)
+        if (*p == delimiter || *p == '\n' || *p == '\r')
+            return p;
+    return end;
+}
+
+static size_t count_quotes(const char *p, const char *end) {
+    size_t count = 0;
+#ifdef __SSE2__
+    const __m128i quotes = _mm_set1_epi8('"');
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, quotes)));
+    }
+#endif
+    for (; p < end; ++p)
+        count += *p == '"';
+    return count;
+}
+
+static bool same_name(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+BulkImporter::BulkImporter(const std::string &path, DBHelper::export_format input_format, char delimiter,
+                           bool header, size_t chunk_bytes)
+        : input_format(input_format), delimiter(delimiter), chunk_bytes(std::max<size_t>(chunk_bytes, 1)) {
+    if (input_format != DBHelper::CSV && input_format != DBHelper::JSON_LINES)
+        throw std::invalid_argument("BulkImporter::BulkImporter -> only CSV and JSON Lines can be imported");
+
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "BulkImporter::BulkImporter -> " + path);
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "BulkImporter::BulkImporter -> " + path);
+    }
+    size = static_cast<size_t>(status.st_size);
+    if (size > 0) {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "BulkImporter::BulkImporter -> " + path);
+        }
+        data = static_cast<const char *>(mapped);
+        //  every chunk is read front to back once
+        madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+
+    const char *end = data + size;
+    body = data;
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        body += 3;
+
+    if (input_format == DBHelper::CSV && header && body < end) {
+        //  the header is parsed like a row of text fields, each one its own target
+        size_t fields = 1;
+        const char *header_end = body;
+        for (bool quoted = false; header_end < end; ++header_end) {
+            if (*header_end == '"')
+                quoted = !quoted;
+            else if (!quoted && *header_end == this->delimiter)
+                ++fields;
+            else if (!quoted && *header_end == '\n') {
+                ++header_end;
+                break;
+            }
+        }
+        for (size_t i = 0; i < fields; ++i) {
+            targets.push_back({{}, TEXT});
+            field_targets.push_back(static_cast<int>(i));
+        }
+        chunk names;
+        parse_csv(body, header_end, header_end, names);
+        if (names.rows == 1)
+            for (const value &name: names.values)
+                this->header.emplace_back(name.type == TEXT_VALUE ? names.text_of(name) : "");
+        body = header_end;
+        targets.clear();
+        field_targets.clear();
+    }
+}
+
+BulkImporter::~BulkImporter() {
+    if (data)
+        munmap(const_cast<char *>(data), size);
+    if (fd >= 0)
+        close(fd);
+}
+
+void BulkImporter::set_targets(const std::vector<target> &columns) {
+    targets.clear();
+    field_targets.clear();
+    if (input_format == DBHelper::JSON_LINES || header.empty()) {
+        targets = columns;
+        for (size_t i = 0; i < columns.size(); ++i)
+            field_targets.push_back(static_cast<int>(i));
+        return;
+    }
+
+    for (const std::string &name: header) {
+        auto column = std::find_if(columns.begin(), columns.end(), [&name](const target &column) {
+            return same_name(column.name, name);
+        });
+        if (column == columns.end()) {
+            field_targets.push_back(-1);
+            continue;
+        }
+        field_targets.push_back(static_cast<int>(targets.size()));
+        targets.push_back(*column);
+    }
+}
+
+BulkImporter::affinity BulkImporter::affinity_of(const std::string &declared_type) {
+    std::string type = declared_type;
+    std::transform(type.begin(), type.end(), type.begin(), [](unsigned char c) { return std::toupper(c); });
+    if (type.find("INT") != std::string::npos)
+        return INTEGER;
+    if (type.find("CHAR") != std::string::npos || type.find("CLOB") != std::string::npos ||
+        type.find("TEXT") != std::string::npos)
+        return TEXT;
+    if (type.empty() || type.find("BLOB") != std::string::npos)
+        return BLOB;
+    if (type.find("REAL") != std::string::npos || type.find("FLOA") != std::string::npos ||
+        type.find("DOUB") != std::string::npos)
+        return REAL;
+    return NUMERIC;
+}
+
+std::vector<const char *> BulkImporter::split(size_t threads) const {
+    const char *end = data + size;
+    auto length = static_cast<size_t>(end - body);
+    size_t count = std::max<size_t>(1, (length + chunk_bytes - 1) / chunk_bytes);
+
+    std::vector<const char *> starts(count + 1, end);
+    starts[0] = body;
+    if (count == 1)
+        return starts;
+
+    std::vector<const char *> nominal(count + 1);
+    for (size_t i = 0; i <= count; ++i)
+        nominal[i] = body + std::min(length, i * chunk_bytes);
+
+    //  a newline only ends a CSV row outside of quotes, whether a chunk starts inside quotes follows from the
+    //  amount of quotes before it, counted in parallel
+    std::vector<size_t> quotes(count, 0);
+    if (input_format == DBHelper::CSV) {
+        std::atomic<size_t> next{0};
+        auto count_chunks = [&] {
+            for (size_t i; (i = next++) < count;)
+                quotes[i] = count_quotes(nominal[i], nominal[i + 1]);
+        };
+        std::vector<std::thread> counters;
+        for (size_t i = 1; i < std::min(threads, count); ++i)
+            counters.emplace_back(count_chunks);
+        count_chunks();
+        for (std::thread &counter: counters)
+            counter.join();
+    }
+
+    size_t quotes_before = 0;
+    for (size_t i = 1; i < count; ++i) {
+        quotes_before += quotes[i - 1];
+        bool quoted = quotes_before % 2 == 1;
+        if (starts[i - 1] >= nominal[i]) {
+            //  the previous chunk's first row reaches past where this chunk would start, the previous one stays empty
+            starts[i] = starts[i - 1];
+            continue;
+        }
+        const char *p = nominal[i];
+        for (; p < end; ++p) {
+            if (*p == '"' && input_format == DBHelper::CSV)
+                quoted = !quoted;
+            else if (*p == '\n' && !quoted)
+                break;
+        }
+        starts[i] = p < end ? p + 1 : end;
+    }
+    return starts;
+}
+
+void BulkImporter::run(size_t threads, const std::function<bool(chunk &)> &consume) const {
+    threads = std::max<size_t>(threads, 1);
+    std::vector<const char *> starts = split(threads);
+    //  a row longer than a chunk leaves empty chunks behind, the chunk after a nonempty one starts where it ends
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    const size_t count = starts.size() - 1;
+    const size_t window = 2 * threads;
+
+    std::vector<std::optional<chunk>> parsed(count);
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t consumed = 0;
+    bool stopped = false;
+    std::atomic<size_t> next{0};
+
+    auto parse = [&] {
+        for (size_t i; (i = next++) < count;) {
+            {
+                //  keeps the parsed chunks waiting for the consumer bounded
+                std::unique_lock lock(mutex);
+                changed.wait(lock, [&] { return stopped || i < consumed + window; });
+                if (stopped)
+                    return;
+            }
+            chunk out;
+            out.bytes = starts[i + 1] - starts[i];
+            if (input_format == DBHelper::CSV)
+                parse_csv(starts[i], starts[i + 1], starts[i + 1], out);
+            else
+                parse_json_lines(starts[i], starts[i + 1], out);
+            {
+                std::lock_guard lock(mutex);
+                parsed[i] = std::move(out);
+            }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> parsers;
+    for (size_t i = 0; i < threads; ++i)
+        parsers.emplace_back(parse);
+
+    //  the split guessed from the parity of the quotes is wrong after a quote inside an unquoted field, the chunk
+    //  starting in the middle of a row rejects it, from the chunk before it on the file is parsed on this thread
+    const char *misaligned = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        chunk current;
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return parsed[i].has_value() && (i + 1 == count || parsed[i + 1].has_value()); });
+            if (input_format == DBHelper::CSV && i + 1 < count && parsed[i + 1]->first_row_rejected) {
+                misaligned = starts[i];
+                stopped = true;
+            } else {
+                current = std::move(*parsed[i]);
+                parsed[i].reset();
+            }
+        }
+        if (misaligned) {
+            changed.notify_all();
+            break;
+        }
+        bool keep_going = consume(current);
+        {
+            std::lock_guard lock(mutex);
+            consumed = i + 1;
+            stopped = !keep_going;
+        }
+        changed.notify_all();
+        if (!keep_going)
+            break;
+    }
+
+    for (std::thread &parser: parsers)
+        parser.join();
+
+    const char *end = data + size;
+    for (const char *p = misaligned; p && p < end;) {
+        chunk current;
+        const char *next = parse_csv(p, end, p + std::min<size_t>(chunk_bytes, end - p), current);
+        current.bytes = next - p;
+        p = next;
+        if (!consume(current))
+            break;
+    }
+}
+
+BulkImporter::value BulkImporter::convert(std::string_view raw, bool quoted, affinity type, chunk &out) {
+    value result;
+    if (raw.empty() && !quoted)
+        return result;
+
+    //  numbers are parsed here on the parser threads, sqlite still applies the column's affinity on insert,
+    //  anything it might read differently is left as text for it to convert
+    if (type != TEXT && type != BLOB && !raw.empty()) {
+        const char *end = raw.data() + raw.size();
+        auto integer = std::from_chars(raw.data(), end, result.integer);
+        if (integer.ec == std::errc() && integer.ptr == end) {
+            result.type = INTEGER_VALUE;
+            return result;
+        }
+        auto real = std::from_chars(raw.data(), end, result.real);
+        if (real.ec == std::errc() && real.ptr == end && std::isfinite(result.real)) {
+            result.type = REAL_VALUE;
+            return result;
+        }
+    }
+
+    result.type = TEXT_VALUE;
+    result.text = out.text.size();
+    out.text.append(raw).push_back('\0');
+    return result;
+}
+
+const char *BulkImporter::parse_csv(const char *begin, const char *end, const char *stop, chunk &out) const {
+    std::string unquoted;
+    const char *p = begin;
+    while (p < end && p < stop) {
+        const size_t row = out.values.size();
+        const size_t row_text = out.text.size();
+        out.values.resize(row + targets.size());
+
+        size_t fields = 0;
+        bool malformed = false;
+        bool blank = false;
+        for (;;) {
+            std::string_view raw;
+            bool quoted = p < end && *p == '"';
+            if (quoted) {
+                //  "" inside quotes is one quote
+                unquoted.clear();
+                for (++p;;) {
+                    auto *quote = static_cast<const char *>(std::memchr(p, '"', end - p));
+                    if (!quote) {
+                        unquoted.append(p, end);
+                        p = end;
+                        malformed = true;
+                        break;
+                    }
+                    unquoted.append(p, quote);
+                    p = quote + 1;
+                    if (p < end && *p == '"') {
+                        unquoted.push_back('"');
+                        ++p;
+                    } else
+                        break;
+                }
+                raw = unquoted;
+                if (p < end && *p != delimiter && *p != '\n' && *p != '\r') {
+                    malformed = true;
+                    p = find_field_end(p, end, delimiter);
+                }
+            } else {
+                const char *field_end = find_field_end(p, end, delimiter);
+                raw = std::string_view(p, field_end - p);
+                p = field_end;
+            }
+
+            if (fields < field_targets.size() && field_targets[fields] >= 0) {
+                const target &column = targets[field_targets[fields]];
+                out.values[row + field_targets[fields]] = convert(raw, quoted, column.type, out);
+            }
+            ++fields;
+
+            if (p < end && *p == delimiter) {
+                ++p;
+                continue;
+            }
+            blank = fields == 1 && raw.empty() && !quoted;
+            if (p < end && *p == '\r')
+                ++p;
+            if (p < end && *p == '\n')
+                ++p;
+            break;
+        }
+
+        if (!malformed && fields == field_targets.size()) {
+            ++out.rows;
+            continue;
+        }
+        out.values.resize(row);
+        out.text.resize(row_text);
+        if (!blank) {
+            out.first_row_rejected |= out.rows + out.rejected == 0;
+            ++out.rejected;
+        }
+    }
+    return p;
+}
+
+/// reads the JSON at <b>p</b> into <b>out</b>, nothing is allocated once <b>out</b> is big enough
+class json_reader {
+    const char *p;
+    const char *end;
+
+public:
+    json_reader(const char *begin, const char *end) : p(begin), end(end) {}
+
+    inline const char *position() const { return p; }
+
+    void skip_whitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    inline bool peek(char c) {
+        skip_whitespace();
+        return p < end && *p == c;
+    }
+
+    /// reads a string and decodes its escapes, the opening quote has to be next
+    bool string(std::string &out) {
+        out.clear();
+        if (!consume('"'))
+            return false;
+        while (p < end) {
+            const char *special = p;
+            while (special < end && *special != '"' && *special != '\\' && *special != '\n')
+                ++special;
+            out.append(p, special);
+            p = special;
+            if (p == end || *p == '\n')
+                return false;
+            if (*p++ == '"')
+                return true;
+            if (p == end)
+                return false;
+            switch (char escaped = *p++) {
+                case 'b':
+                    out.push_back('\b');
+                    break;
+                case 'f':
+                    out.push_back('\f');
+                    break;
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'u': {
+                    uint32_t code;
+                    if (!hex(code))
+                        return false;
+                    //  a surrogate pair encodes one character above U+FFFF
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 2 && p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        uint32_t low;
+                        if (!hex(low) || low < 0xDC00 || low >= 0xE000)
+                            return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    utf8(code, out);
+                    break;
+                }
+                default:
+                    out.push_back(escaped);
+            }
+        }
+        return false;
+    }
+
+    /// @return the text of a number, true, false or null, empty if something else is next
+    std::string_view literal() {
+        skip_whitespace();
+        const char *begin = p;
+        while (p < end && (std::isalnum(static_cast<unsigned char>(*p)) || *p == '-' || *p == '+' || *p == '.'))
+            ++p;
+        return {begin, static_cast<size_t>(p - begin)};
+    }
+
+    /// skips an object or array and returns its text
+    std::string_view nested() {
+        skip_whitespace();
+        const char *begin = p;
+        int depth = 0;
+        for (bool in_string = false; p < end && *p != '\n'; ++p) {
+            if (in_string) {
+                if (*p == '\\')
+                    ++p;
+                else if (*p == '"')
+                    in_string = false;
+            } else if (*p == '"')
+                in_string = true;
+            else if (*p == '{' || *p == '[')
+                ++depth;
+            else if ((*p == '}' || *p == ']') && --depth == 0) {
+                ++p;
+                return {begin, static_cast<size_t>(p - begin)};
+            }
+        }
+        return {};
+    }
+
+private:
+    bool hex(uint32_t &code) {
+        if (end - p < 4)
+            return false;
+        auto result = std::from_chars(p, p + 4, code, 16);
+        if (result.ptr != p + 4)
+            return false;
+        p += 4;
+        return true;
+    }
+
+    static void utf8(uint32_t code, std::string &out) {
+        if (code < 0x80)
+            out.push_back(static_cast<char>(code));
+        else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | code >> 6));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | code >> 12));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | code >> 18));
+            out.push_back(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+};
+
+void BulkImporter::parse_json_lines(const char *begin, const char *end, chunk &out) const {
+    std::string key;
+    std::string text;
+    for (const char *line = begin; line < end;) {
+        const char *line_end = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        line_end = line_end ? line_end : end;
+
+        const size_t row = out.values.size();
+        const size_t row_text = out.text.size();
+        json_reader reader(line, line_end);
+        bool malformed = !reader.consume('{');
+        if (malformed) {
+            reader.skip_whitespace();
+            //  blank lines are skipped silently
+            malformed = reader.position() != line_end;
+            line = line_end + 1;
+            if (malformed)
+                ++out.rejected;
+            continue;
+        }
+
+        out.values.resize(row + targets.size());
+        for (bool first = true; !malformed && !reader.consume('}'); first = false) {
+            if ((!first && !reader.consume(',')) || !reader.string(key) || !reader.consume(':')) {
+                malformed = true;
+                break;
+            }
+            auto column = std::find_if(targets.begin(), targets.end(), [&key](const target &column) {
+                return same_name(column.name, key);
+            });
+            //  keys without a column are parsed and dropped
+            bool wanted = column != targets.end();
+            affinity type = wanted ? column->type : TEXT;
+            value parsed;
+
+            if (reader.peek('"')) {
+                malformed = !reader.string(text);
+                if (wanted)
+                    parsed = convert(text, true, type, out);
+            } else if (reader.peek('{') || reader.peek('[')) {
+                std::string_view nested = reader.nested();
+                malformed = nested.empty();
+                if (wanted)
+                    parsed = convert(nested, true, TEXT, out);
+            } else {
+                std::string_view literal = reader.literal();
+                if (literal == "null")
+                    parsed = value();
+                else if (literal == "true" || literal == "false") {
+                    parsed.type = INTEGER_VALUE;
+                    parsed.integer = literal == "true";
+                } else {
+                    //  a number the column doesn't convert is stored as written, json numbers never start with a
+                    //  letter, anything else left in <b>literal</b> is malformed
+                    malformed = literal.empty() || std::isalpha(static_cast<unsigned char>(literal.front()));
+                    if (wanted)
+                        parsed = convert(literal, false, type == BLOB ? NUMERIC : type, out);
+                }
+            }
+            if (wanted)
+                out.values[row + (column - targets.begin())] = parsed;
+        }
+        reader.skip_whitespace();
+        malformed |= reader.position() != line_end;
+
+        if (malformed) {
+            out.values.resize(row);
+            out.text.resize(row_text);
+            ++out.rejected;
+        } else
+            ++out.rows;
+        line = line_end + 1;
+    }
+}
@@ -6,22 +6,28 @@
 #include <vector>
 #include <unordered_map>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
 #include <my_utils/OSUtils.h>
+#include <sqlite3.h>
 
 #include "../include/DBHelper.h"
+#include "../include/BulkImporter.h"
 
 
 DBHelper::DBHelper() {
-    this->db_full_path = DBHelper::default_path.empty() ? get_default_dir_path("database.db3") : DBHelper::default_path;
+    this->db_full_path = DBHelper::default_path.empty() ? default_db_path() : DBHelper::default_path;
     set_db_dir_path(db_full_path);
     set_db_name(db_full_path);
     create_db_dir();
-    try {
-        database = new SQLite::Database(db_full_path,
-                                        SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
-    } catch (SQLite::Exception &e) {
-        std::cerr << "DBHelper::DBHelper -> failed to open database: " << e.what() << std::endl;
-    }
+    open(SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
 }
 
 DBHelper::DBHelper(const std::string &db_path) {
@@ -29,37 +35,112 @@ DBHelper::DBHelper(const std::string &db_path) {
     set_db_dir_path(db_path);
     set_db_name(db_path);
     create_db_dir();
-    try {
-        database = new SQLite::Database(db_full_path,
-                                        SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
-    } catch (SQLite::Exception &e) {
-        std::cerr << "DBHelper::DBHelper -> failed to open database: " << e.what() << std::endl;
-    }
+    open(SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
+}
+
+DBHelper::DBHelper(const std::string &db_path, shared_tag) {
+    this->db_full_path = db_path;
+    set_db_dir_path(db_path);
+    set_db_name(db_path);
+    open_shared();
+}
+
+std::unique_ptr<DBHelper> DBHelper::shared() {
+    return shared(DBHelper::default_path.empty() ? default_db_path() : DBHelper::default_path);
+}
+
+std::unique_ptr<DBHelper> DBHelper::shared(const std::string &db_path) {
+    return std::unique_ptr<DBHelper>(new DBHelper(db_path, shared_tag()));
 }
 
 DBHelper::DBHelper(const int &permissions) {
-    this->db_full_path = default_path.empty() ? get_default_dir_path("database.db3") : default_path;
+    this->db_full_path = default_path.empty() ? default_db_path() : default_path;
     set_db_dir_path(db_full_path);
     set_db_name(db_full_path);
     create_db_dir();
-    try {
-        database = new SQLite::Database(db_full_path,
-                                        SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
-    } catch (SQLite::Exception &e) {
-        std::cerr << "DBHelper::DBHelper -> failed to open database: " << e.what() << std::endl;
-    }
+    open(SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
 }
 
 DBHelper::DBHelper(const std::string &db_path,
                    const int &permissions) {
+    this->db_full_path = db_path;
+    set_db_dir_path(db_path);
+    set_db_name(db_path);
+    if (permissions & SQLite::OPEN_CREATE)
+        create_db_dir();
+    open(permissions);
+}
+
+DBHelper::DBHelper(const options &opts) : DBHelper() {
+    configure(opts);
+}
+
+DBHelper::DBHelper(const std::string &db_path,
+                   const options &opts) : DBHelper(db_path) {
+    configure(opts);
+}
+
+DBHelper::~DBHelper() {
+    if (database) {
+        flush_slow_queries();
+        //  the callbacks stay installed for the other DBHelpers of a shared connection
+        clear_result_cache();
+        result_cache_capacity = 0;
+        instrumentation = false;
+        slow_query_threshold = std::chrono::nanoseconds(-1);
+        auto &helpers = db_connection->helpers;
+        helpers.erase(std::find(helpers.begin(), helpers.end(), this));
+        update_trace_callback();
+        update_hooks();
+    }
+    //  cached statements have to be finalized before the connection can be closed
+    clear_statement_cache();
+    schema_version_query.reset();
+    db_connection.reset();
+}
+
+DBHelper::connection::~connection() = default;
+
+void DBHelper::open_shared() {
+    //  per thread, connections are opened without a mutex of their own, the registry goes with its thread so a
+    //  thread reusing the id of a finished one never finds its connections
+    thread_local std::unordered_map<std::string, std::weak_ptr<connection>> registry;
+
+    const bool shareable = !db_full_path.empty() && db_full_path != ":memory:" && db_full_path.rfind("file:", 0) != 0;
+    if (shareable) {
+        auto it = registry.find(db_full_path);
+        if (it != registry.end())
+            if (std::shared_ptr<connection> open = it->second.lock()) {
+                attach(std::move(open));
+                return;
+            }
+    }
+
+    create_db_dir();
+    open(SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
+    if (!shareable || !db_connection)
+        return;
+
+    for (auto it = registry.begin(); it != registry.end();)
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+    registry[db_full_path] = db_connection;
+}
+
+void DBHelper::open(int permissions) {
     try {
-        database = new SQLite::Database(db_full_path, permissions);
+        auto opened = std::make_shared<connection>();
+        opened->database = std::make_unique<SQLite::Database>(db_full_path, permissions);
+        attach(std::move(opened));
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::DBHelper -> failed to open database: " << e.what() << std::endl;
     }
 }
 
-DBHelper::~DBHelper() { delete database; }
+void DBHelper::attach(std::shared_ptr<connection> opened) {
+    db_connection = std::move(opened);
+    database = db_connection->database.get();
+    db_connection->helpers.push_back(this);
+}
 
 void DBHelper::set_db_name(const std::string &full_path) {
     this->db_name = full_path.substr(full_path.find_last_of('/') + 1);
@@ -69,6 +150,11 @@ void DBHelper::set_db_dir_path(std::string full_path) {
     this->db_dir_path = full_path.erase(full_path.find_last_of('/') + 1);
 }
 
+const std::string &DBHelper::default_db_path() {
+    static const std::string path = get_default_dir_path("database.db3");
+    return path;
+}
+
 std::string DBHelper::get_default_dir_path(const std::string &db_name) {
     if (mutl::is_linux()) {
         if (mutl::is_elevated())
@@ -86,6 +172,10 @@ std::string DBHelper::get_default_dir_path(const std::string &db_name) {
 }
 
 void DBHelper::create_db_dir() {
+    //  in memory databases and URIs have no directory to create
+    if (is_in_memory() || db_full_path.rfind("file:", 0) == 0)
+        return;
+
     if (db_dir_path.empty()) {
         std::cerr << "DBHelper::create_db_dir -> db_dir_path not set" << std::endl;
         return;
@@ -96,20 +186,122 @@ void DBHelper::create_db_dir() {
 
 bool DBHelper::table_exists(const std::string &table_name) {
     try {
-        return database->tableExists(table_name);
+        validate_schema_cache();
+        if (!table_names_loaded) {
+            SQLite::Statement query(*database, "SELECT name FROM sqlite_master WHERE type='table'");
+            while (query.executeStep())
+                table_names.insert(query.getColumn(0).getString());
+            table_names_loaded = true;
+        }
+        //  matched exactly like the name=? lookup into sqlite_master it replaces
+        return table_names.count(table_name);
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::table_exists -> " << e.what() << std::endl;
         return false;
     }
 }
 
+std::shared_ptr<const DBHelper::table_schema> DBHelper::get_schema(const std::string &table_name) {
+    try {
+        validate_schema_cache();
+        std::string key = table_name;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        auto cached = schema_cache.find(key);
+        if (cached != schema_cache.end())
+            return cached->second;
+
+        //  missing tables are cached too, creating them changes the schema version
+        return schema_cache.emplace(std::move(key), load_schema(table_name)).first->second;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::get_schema -> " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+int DBHelper::column_index(const std::string &table_name, std::string_view column) {
+    std::shared_ptr<const table_schema> schema = get_schema(table_name);
+    return schema ? schema->column_index(column) : -1;
+}
+
+int DBHelper::table_schema::column_index(std::string_view column) const {
+    auto same = [column](const column_schema &c) {
+        return std::equal(c.name.begin(), c.name.end(), column.begin(), column.end(), [](unsigned char a, unsigned char b) {
+            return std::tolower(a) == std::tolower(b);
+        });
+    };
+    auto it = std::find_if(columns.begin(), columns.end(), same);
+    return it == columns.end() ? -1 : static_cast<int>(it - columns.begin());
+}
+
+void DBHelper::clear_schema_cache() {
+    schema_cache.clear();
+    table_names.clear();
+    table_names_loaded = false;
+    schema_cache_version = -1;
+}
+
+void DBHelper::validate_schema_cache() {
+    if (!schema_version_query)
+        schema_version_query = std::make_unique<SQLite::Statement>(*database, "PRAGMA schema_version");
+    schema_version_query->executeStep();
+    int64_t version = schema_version_query->getColumn(0).getInt64();
+    schema_version_query->reset();
+
+    //  a rollback restores the version the schema had before, a later change of the schema can then bring back
+    //  the version schemas read inside the rolled back transaction were cached with
+    const bool in_transaction = sqlite3_get_autocommit(database->getHandle()) == 0;
+    if (version != schema_cache_version || (schema_cache_tentative && !in_transaction)) {
+        clear_schema_cache();
+        schema_cache_version = version;
+        schema_cache_tentative = in_transaction;
+    }
+}
+
+std::shared_ptr<const DBHelper::table_schema> DBHelper::load_schema(const std::string &table_name) {
+    auto schema = std::make_shared<table_schema>();
+    schema->name = table_name;
+
+    SQLite::Statement columns(*database, "SELECT name, type, \"notnull\", dflt_value, pk FROM pragma_table_info(?)");
+    columns.bind(1, table_name);
+    while (columns.executeStep())
+        schema->columns.push_back({columns.getColumn(0).getString(), columns.getColumn(1).getString(),
+                                   columns.getColumn(2).getInt() != 0, columns.getColumn(3).getString(),
+                                   columns.getColumn(4).getInt()});
+    if (schema->columns.empty())
+        return nullptr;
+
+    std::vector<const column_schema *> key;
+    for (const column_schema &column: schema->columns)
+        if (column.primary_key_position > 0)
+            key.push_back(&column);
+    std::sort(key.begin(), key.end(), [](const column_schema *a, const column_schema *b) {
+        return a->primary_key_position < b->primary_key_position;
+    });
+    for (const column_schema *column: key)
+        schema->primary_key.push_back(column->name);
+
+    SQLite::Statement indexes(*database,
+                              "SELECT list.name, list.\"unique\", list.origin, info.name "
+                              "FROM pragma_index_list(?) AS list, pragma_index_info(list.name) AS info "
+                              "ORDER BY list.seq, info.seqno");
+    indexes.bind(1, table_name);
+    while (indexes.executeStep()) {
+        std::string name = indexes.getColumn(0).getString();
+        if (schema->indexes.empty() || schema->indexes.back().name != name)
+            schema->indexes.push_back({std::move(name), indexes.getColumn(1).getInt() != 0,
+                                       indexes.getColumn(2).getString(), {}});
+        schema->indexes.back().columns.push_back(indexes.getColumn(3).getString());
+    }
+    return schema;
+}
+
 std::shared_ptr<SQLite::Statement>
 DBHelper::select(const std::string &table_name) {
     try {
         std::string sql = mutl::concatenate(
                 "SELECT * FROM ", table_name);
 
-        return std::make_shared<SQLite::Statement>(*database, sql);
+        return prepare(sql);
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::select -> " << e.what() << std::endl;
         return {};
@@ -123,7 +315,7 @@ DBHelper::select(const std::string &table_name, const std::string &column) {
                 "SELECT ", column,
                 " FROM ", table_name);
 
-        return std::make_shared<SQLite::Statement>(*database, sql);
+        return prepare(sql);
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::select -> " << e.what() << std::endl;
         return {};
@@ -138,10 +330,7 @@ DBHelper::select(const std::string &table_name,
                 "SELECT ", columns.empty() ? "*" : mutl::format_with_comma<std::string>(columns),
                 " FROM ", table_name);
 
-        std::shared_ptr<SQLite::Statement> query =
-                std::make_shared<SQLite::Statement>(*database, sql);
-
-        return query;
+        return prepare(sql);
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::select -> " << e.what() << std::endl;
         return {};
@@ -156,13 +345,105 @@ DBHelper::select(const std::string &table_name,
                 "SELECT ", empty(columns) ? "*" : mutl::format_with_comma(columns),
                 " FROM ", table_name);
 
-        return std::make_shared<SQLite::Statement>(*database, sql);
+        return prepare(sql);
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::select -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+std::shared_ptr<SQLite::Statement>
+DBHelper::select(const std::string &table_name, const order_by &ordering) {
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT * FROM ", table_name,
+                format_order_by(ordering)));
+        bind_order_by(*query, 1, ordering);
+
+        return query;
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::select -> " << e.what() << std::endl;
         return {};
     }
 }
 
+std::string DBHelper::format_order_by(const order_by &ordering) {
+    std::string sql;
+    if (!ordering.column.empty())
+        sql.append(" ORDER BY ").append(ordering.column).append(ordering.order == ASC ? " ASC" : " DESC");
+    //  a negative limit is no limit, keeps the sql the same for every limit and offset
+    sql.append(" LIMIT ? OFFSET ?");
+    return sql;
+}
+
+void DBHelper::bind_order_by(SQLite::Statement &query, int index, const order_by &ordering) {
+    query.bind(index, ordering.limit == 0 ? int64_t(-1) : static_cast<int64_t>(ordering.limit));
+    query.bind(index + 1, static_cast<int64_t>(ordering.offset));
+}
+
+std::string DBHelper::page_token(const SQLite::Statement &query) {
+    //  <rowid>:<type><key>, the key keeps its storage class so it compares the same way when bound again
+    std::string token = std::to_string(query.getColumn(0).getInt64()) + ':';
+    SQLite::Column key = query.getColumn(1);
+    if (key.isInteger()) {
+        token.append("i").append(std::to_string(key.getInt64()));
+    } else if (key.isFloat()) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.17g", key.getDouble());
+        token.append("f").append(number);
+    } else if (key.isBlob()) {
+        //  hex keeps the token printable, a blob bound back as text would compare below every blob
+        static constexpr char digits[] = "0123456789abcdef";
+        const auto *bytes = static_cast<const unsigned char *>(key.getBlob());
+        token.append("b");
+        for (int i = 0; i < key.getBytes(); ++i)
+            token.append({digits[bytes[i] >> 4], digits[bytes[i] & 0xf]});
+    } else {
+        token.append("t").append(key.getText(), key.getBytes());
+    }
+    return token;
+}
+
+void DBHelper::bind_page_token(SQLite::Statement &query, int index, const std::string &token) {
+    size_t separator = token.find(':');
+    if (separator == std::string::npos || separator + 1 >= token.size())
+        throw std::invalid_argument("malformed page token: " + token);
+
+    try {
+        int64_t rowid = std::stoll(token.substr(0, separator));
+        std::string key = token.substr(separator + 2);
+        switch (token[separator + 1]) {
+            case 'i':
+                query.bind(index, static_cast<int64_t>(std::stoll(key)));
+                query.bind(index + 1, static_cast<int64_t>(std::stoll(key)));
+                break;
+            case 'f':
+                query.bind(index, std::stod(key));
+                query.bind(index + 1, std::stod(key));
+                break;
+            case 't':
+                query.bind(index, key);
+                query.bind(index + 1, key);
+                break;
+            case 'b': {
+                if (key.size() % 2 != 0 || key.find_first_not_of("0123456789abcdef") != std::string::npos)
+                    throw std::invalid_argument("malformed page token: " + token);
+                std::string blob(key.size() / 2, '\0');
+                for (size_t i = 0; i < blob.size(); ++i)
+                    blob[i] = static_cast<char>(std::stoi(key.substr(2 * i, 2), nullptr, 16));
+                query.bind(index, blob.data(), static_cast<int>(blob.size()));
+                query.bind(index + 1, blob.data(), static_cast<int>(blob.size()));
+                break;
+            }
+            default:
+                throw std::invalid_argument("malformed page token: " + token);
+        }
+        query.bind(index + 2, rowid);
+    } catch (std::out_of_range &e) {
+        throw std::invalid_argument("malformed page token: " + token);
+    }
+}
+
 std::shared_ptr<SQLite::Statement> DBHelper::execute(const std::string &sql) {
     try {
         std::shared_ptr<SQLite::Statement> query = std::make_shared<SQLite::Statement>(*database, sql);
@@ -176,7 +457,22 @@ std::shared_ptr<SQLite::Statement> DBHelper::execute(const std::string &sql) {
 std::string DBHelper::drop(const std::string &table_name) {
     try {
         std::string sql = "DROP TABLE IF EXISTS " + table_name;
+        //  a cached statement left mid-step keeps the table locked
+        reset_statement_cache();
         database->exec(sql);
+
+        //  the triggers went with the table, the counter has to go by hand
+        if (table_exists("dbhelper_row_counts")) {
+            SQLite::Statement counter(*database, "DELETE FROM dbhelper_row_counts WHERE table_name=?");
+            counter.bind(1, table_name);
+            counter.exec();
+        }
+
+        const std::string prefix = table_name + '.';
+        auto &filters = db_connection->bloom_filters;
+        for (auto it = filters.begin(); it != filters.end();)
+            it = it->first.rfind(prefix, 0) == 0 ? filters.erase(it) : std::next(it);
+        update_hooks();
         return sql;
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::drop -> " << e.what() << std::endl;
@@ -187,16 +483,588 @@ std::string DBHelper::drop(const std::string &table_name) {
 void DBHelper::write_to_cli(const std::string &table_name) {
     try {
         SQLite::Statement query(*database, "SELECT * FROM " + table_name);
+        std::vector<std::string> labels;
+        for (int i = 0; i < query.getColumnCount(); ++i)
+            labels.push_back(std::string(query.getColumnName(i)) + ": ");
+
         while (query.executeStep()) {
             for (int i = 0; i < query.getColumnCount(); ++i)
-                std::cout << query.getColumnName(i) << ": " << query.getColumn(i) << "\t";
-            std::cout << std::endl;
+                std::cout << labels[i] << query.getColumn(i) << '\t';
+            std::cout << '\n';
         }
+        std::cout.flush();
     } catch (SQLite::Exception &e) {
         std::cerr << "DBHelper::write_to_cli -> " << e.what() << std::endl;
     }
 }
 
+static std::string json_escape(const std::string &text) {
+    std::string result;
+    result.reserve(text.size() + 2);
+    for (char c: text) {
+        switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    result += escaped;
+                } else {
+                    result += c;
+                }
+        }
+    }
+    return result;
+}
+
+namespace {
+/// fixed buffer in front of a file descriptor, written out with as few write() calls as possible
+class export_buffer {
+    static constexpr size_t capacity = 1 << 20;
+
+    int fd;
+    std::unique_ptr<char[]> data{new char[capacity]};
+    size_t used = 0;
+
+public:
+    explicit export_buffer(int fd) : fd(fd) {}
+
+    void put(char c) {
+        if (used == capacity)
+            flush();
+        data[used++] = c;
+    }
+
+    void put(const char *text, size_t size) {
+        if (size > capacity - used) {
+            flush();
+            if (size >= capacity) {
+                write_all(text, size);
+                return;
+            }
+        }
+        std::memcpy(data.get() + used, text, size);
+        used += size;
+    }
+
+    void put(std::string_view text) { put(text.data(), text.size()); }
+
+    template<typename T>
+    void put_number(T value) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        put(digits, result.ptr - digits);
+    }
+
+    void put_little_endian(uint64_t value, int bytes) {
+        char encoded[8];
+        for (int i = 0; i < bytes; ++i)
+            encoded[i] = static_cast<char>(value >> (8 * i));
+        put(encoded, bytes);
+    }
+
+    void put_hex(const void *blob, size_t size) {
+        static constexpr char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < size; ++i) {
+            auto byte = static_cast<const unsigned char *>(blob)[i];
+            put(digits[byte >> 4]);
+            put(digits[byte & 0xf]);
+        }
+    }
+
+    /// double quoted with the quotes inside doubled if <b>text</b> holds a separator, quote or line break
+    void put_csv(const char *text, size_t size) {
+        //  an empty field is NULL, empty text is quoted to tell them apart
+        if (size != 0 && std::string_view(text, size).find_first_of(",\"\r\n") == std::string_view::npos) {
+            put(text, size);
+            return;
+        }
+        put('"');
+        for (const char *end = text + size, *quote; text < end; text = quote + 1) {
+            quote = static_cast<const char *>(std::memchr(text, '"', end - text));
+            if (!quote) {
+                put(text, end - text);
+                break;
+            }
+            put(text, quote - text + 1);
+            put('"');
+        }
+        put('"');
+    }
+
+    void put_json(const char *text, size_t size) {
+        put('"');
+        size_t clean = 0;
+        for (size_t i = 0; i < size; ++i) {
+            auto c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            put(text + clean, i - clean);
+            clean = i + 1;
+            switch (c) {
+                case '"':
+                    put("\\\"");
+                    break;
+                case '\\':
+                    put("\\\\");
+                    break;
+                case '\n':
+                    put("\\n");
+                    break;
+                case '\r':
+                    put("\\r");
+                    break;
+                case '\t':
+                    put("\\t");
+                    break;
+                default:
+                    put("\\u00");
+                    put_hex(&c, 1);
+            }
+        }
+        put(text + clean, size - clean);
+        put('"');
+    }
+
+    void flush() {
+        write_all(data.get(), used);
+        used = 0;
+    }
+
+private:
+    void write_all(const char *bytes, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "write");
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+};
+}
+
+long long DBHelper::export_table(const std::string &table_name, int fd, export_format format) {
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare("SELECT * FROM " + table_name);
+        long long rows = export_rows(*query, fd, format);
+        query->reset();
+        return rows;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::export_table -> " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+long long DBHelper::export_rows(SQLite::Statement &query, int fd, export_format format) {
+    try {
+        export_buffer out(fd);
+        const int column_count = query.getColumnCount();
+
+        //  everything that only depends on the column names is formatted once up front
+        std::vector<std::string> json_keys;
+        if (format == CSV) {
+            for (int i = 0; i < column_count; ++i) {
+                if (i)
+                    out.put(',');
+                const char *name = query.getColumnName(i);
+                out.put_csv(name, std::strlen(name));
+            }
+            out.put('\n');
+        } else if (format == JSON_LINES) {
+            for (int i = 0; i < column_count; ++i)
+                json_keys.push_back(std::string(i ? ",\"" : "{\"") + json_escape(query.getColumnName(i)) + "\":");
+        } else {
+            out.put("DBHX");
+            out.put_little_endian(column_count, 4);
+            for (int i = 0; i < column_count; ++i) {
+                const char *name = query.getColumnName(i);
+                size_t size = std::strlen(name);
+                out.put_little_endian(size, 4);
+                out.put(name, size);
+            }
+        }
+
+        long long rows = 0;
+        while (query.executeStep()) {
+            for (int i = 0; i < column_count; ++i) {
+                SQLite::Column column = query.getColumn(i);
+                int type = column.getType();
+                if (format == CSV && i)
+                    out.put(',');
+                else if (format == JSON_LINES)
+                    out.put(json_keys[i]);
+                else if (format == BINARY)
+                    out.put(static_cast<char>(type));
+
+                switch (type) {
+                    case SQLITE_INTEGER:
+                        if (format == BINARY)
+                            out.put_little_endian(column.getInt64(), 8);
+                        else
+                            out.put_number(column.getInt64());
+                        break;
+                    case SQLITE_FLOAT: {
+                        double number = column.getDouble();
+                        if (format == BINARY) {
+                            uint64_t bits;
+                            std::memcpy(&bits, &number, sizeof(bits));
+                            out.put_little_endian(bits, 8);
+                        } else if (format == JSON_LINES && !std::isfinite(number))
+                            out.put("null");
+                        else
+                            out.put_number(number);
+                        break;
+                    }
+                    case SQLITE_TEXT: {
+                        //  sqlite has to convert the value before it knows its size in bytes
+                        const char *text = column.getText();
+                        auto size = static_cast<size_t>(column.getBytes());
+                        if (format == CSV)
+                            out.put_csv(text, size);
+                        else if (format == JSON_LINES)
+                            out.put_json(text, size);
+                        else {
+                            out.put_little_endian(size, 4);
+                            out.put(text, size);
+                        }
+                        break;
+                    }
+                    case SQLITE_BLOB: {
+                        const void *blob = column.getBlob();
+                        auto size = static_cast<size_t>(column.getBytes());
+                        if (format == BINARY) {
+                            out.put_little_endian(size, 4);
+                            out.put(static_cast<const char *>(blob), size);
+                        } else {
+                            if (format == JSON_LINES)
+                                out.put('"');
+                            out.put_hex(blob, size);
+                            if (format == JSON_LINES)
+                                out.put('"');
+                        }
+                        break;
+                    }
+                    default:
+                        if (format == JSON_LINES)
+                            out.put("null");
+                }
+            }
+            if (format == JSON_LINES)
+                out.put(column_count ? "}\n" : "{}\n");
+            else if (format == CSV)
+                out.put('\n');
+            ++rows;
+        }
+        out.flush();
+        return rows;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::export_rows -> " << e.what() << std::endl;
+        return -1;
+    } catch (std::system_error &e) {
+        std::cerr << "DBHelper::export_rows -> " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+DBHelper::import_stats DBHelper::import_file(const std::string &table_name, const std::string &path) {
+    return import_file(table_name, path, import_options());
+}
+
+DBHelper::import_stats DBHelper::import_file(const std::string &table_name, const std::string &path,
+                                             const import_options &opts) {
+    import_stats stats;
+    const auto start = std::chrono::steady_clock::now();
+    if (opts.format == BINARY) {
+        std::cerr << "DBHelper::import_file -> the binary export format can't be imported" << std::endl;
+        return stats;
+    }
+
+    const bool own_transaction = !in_transaction();
+    std::optional<options> previous;
+    try {
+        std::shared_ptr<const table_schema> schema = get_schema(table_name);
+        if (!schema)
+            throw SQLite::Exception("no such table: " + table_name);
+        std::vector<BulkImporter::target> columns;
+        for (const column_schema &column: schema->columns)
+            columns.push_back({column.name, BulkImporter::affinity_of(column.declared_type)});
+
+        BulkImporter importer(path, opts.format, opts.delimiter, opts.header, opts.chunk_bytes);
+        importer.set_targets(columns);
+        const std::vector<BulkImporter::target> &targets = importer.get_targets();
+        if (targets.empty())
+            throw SQLite::Exception("no field of " + path + " matches a column of " + table_name);
+
+        std::vector<std::string> names;
+        for (const BulkImporter::target &target: targets)
+            names.push_back(target.name);
+        const size_t statement_rows = max_rows_per_statement(names.size());
+        std::shared_ptr<SQLite::Statement> batch = prepare(multi_row_insert_sql(table_name, names, statement_rows));
+        std::shared_ptr<SQLite::Statement> single = prepare(multi_row_insert_sql(table_name, names, 1));
+
+        //  the journal mode can't change inside a transaction and the busy timeout can't be read back,
+        //  both are left as they are
+        if (opts.bulk_load && own_transaction) {
+            previous.emplace();
+            previous->synchronous = std::to_string(database->execAndGet("PRAGMA synchronous").getInt());
+            previous->cache_size = database->execAndGet("PRAGMA cache_size").getInt();
+            previous->mmap_size = database->execAndGet("PRAGMA mmap_size").getInt64();
+            previous->temp_store = std::to_string(database->execAndGet("PRAGMA temp_store").getInt());
+
+            options bulk = options::of(BULK_LOAD);
+            bulk.journal_mode.clear();
+            bulk.busy_timeout = -1;
+            configure(bulk);
+        }
+
+        auto insert = [&names](SQLite::Statement &query, const BulkImporter::chunk &parsed, size_t first,
+                               size_t count) {
+            int index = 1;
+            for (size_t i = first * names.size(); i < (first + count) * names.size(); ++i, ++index) {
+                const BulkImporter::value &value = parsed.values[i];
+                switch (value.type) {
+                    case BulkImporter::INTEGER_VALUE:
+                        query.bind(index, value.integer);
+                        break;
+                    case BulkImporter::REAL_VALUE:
+                        query.bind(index, value.real);
+                        break;
+                    case BulkImporter::TEXT_VALUE:
+                        //  the chunk outlives the statement's execution
+                        query.bindNoCopy(index, parsed.text_of(value));
+                        break;
+                    default:
+                        query.bind(index);
+                }
+            }
+            query.exec();
+            query.reset();
+        };
+
+        if (own_transaction && !begin(IMMEDIATE))
+            throw SQLite::Exception("couldn't begin the import transaction");
+        size_t uncommitted = 0;
+        bool failed = false;
+        const size_t threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+        importer.run(threads, [&](BulkImporter::chunk &parsed) {
+            try {
+                size_t row = 0;
+                for (; row + statement_rows <= parsed.rows; row += statement_rows)
+                    insert(*batch, parsed, row, statement_rows);
+                for (; row < parsed.rows; ++row)
+                    insert(*single, parsed, row, 1);
+            } catch (SQLite::Exception &e) {
+                std::cerr << "DBHelper::import_file -> " << e.what() << std::endl;
+                failed = true;
+                return false;
+            }
+            uncommitted += parsed.rows;
+            stats.rejected_rows += parsed.rejected;
+            stats.bytes += parsed.bytes;
+
+            if (own_transaction && uncommitted >= opts.rows_per_transaction) {
+                if (!commit() || !begin(IMMEDIATE)) {
+                    failed = true;
+                    return false;
+                }
+                stats.rows += uncommitted;
+                uncommitted = 0;
+            }
+            return true;
+        });
+
+        if (failed) {
+            if (own_transaction && in_transaction())
+                rollback();
+        } else if (!own_transaction || commit()) {
+            stats.rows += uncommitted;
+            stats.completed = true;
+        }
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::import_file -> " << e.what() << std::endl;
+        if (own_transaction && in_transaction())
+            rollback();
+    } catch (std::system_error &e) {
+        std::cerr << "DBHelper::import_file -> " << e.what() << std::endl;
+    }
+
+    if (previous)
+        configure(*previous);
+    //  refilling beats reading back every imported row
+    const std::string prefix = table_name + '.';
+    if (database)
+        for (auto &[column, filter]: db_connection->bloom_filters)
+            if (column.rfind(prefix, 0) == 0)
+                filter.populated = false;
+
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+    return stats;
+}
+
+std::future<bool> DBHelper::backup_to(const std::string &path, int pages_per_step, std::chrono::milliseconds pause,
+                                      backup_progress_sink progress) {
+    if (!database) {
+        std::promise<bool> failed;
+        failed.set_value(false);
+        return failed.get_future();
+    }
+
+    if (is_in_memory()) {
+        std::promise<bool> done;
+        try {
+            SQLite::Database destination(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
+            done.set_value(copy_pages(database->getHandle(), destination.getHandle(), -1, {}, progress));
+        } catch (SQLite::Exception &e) {
+            std::cerr << "DBHelper::backup_to -> " << e.what() << std::endl;
+            done.set_value(false);
+        }
+        return done.get_future();
+    }
+
+    //  only copies are handed to the thread, the backup may outlive this DBHelper
+    return std::async(std::launch::async, [source_path = db_full_path, path, pages_per_step, pause,
+                                           progress = std::move(progress)] {
+        try {
+            SQLite::Database source(source_path, SQLite::OPEN_READONLY | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
+            SQLite::Database destination(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
+            return copy_pages(source.getHandle(), destination.getHandle(), pages_per_step, pause, progress);
+        } catch (SQLite::Exception &e) {
+            std::cerr << "DBHelper::backup_to -> " << e.what() << std::endl;
+            return false;
+        }
+    });
+}
+
+std::unique_ptr<DBHelper> DBHelper::snapshot_to_memory() {
+    try {
+        auto snapshot = std::make_unique<DBHelper>(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        if (!database || !snapshot->database)
+            return nullptr;
+
+        if (!copy_pages(database->getHandle(), snapshot->database->getHandle(), -1, {}, {}))
+            return nullptr;
+        return snapshot;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::snapshot_to_memory -> " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+bool DBHelper::is_in_memory() const {
+    if (db_full_path.empty() || db_full_path == ":memory:")
+        return true;
+
+    return db_full_path.rfind("file:", 0) == 0 && (db_full_path.rfind("file::memory:", 0) == 0 ||
+                                                   db_full_path.find("mode=memory") != std::string::npos ||
+                                                   db_full_path.find("vfs=memdb") != std::string::npos);
+}
+
+bool DBHelper::load_from_file(const std::string &path) {
+    if (!database)
+        return false;
+
+    try {
+        //  an open transaction would be left running on a database it never saw
+        if (in_transaction())
+            throw SQLite::Exception("can't load a database inside a transaction");
+
+        //  every cache describes the database being replaced, the statements were prepared against its schema
+        clear_statement_cache();
+        schema_version_query.reset();
+        clear_schema_cache();
+        rollback_hook(db_connection.get());
+        //  the pages are replaced under the connection, neither the update hook nor data_version see it
+        db_connection->data_version_query.reset();
+        for (auto &[key, filter]: db_connection->bloom_filters)
+            filter.populated = false;
+
+        SQLite::Database source(path, SQLite::OPEN_READONLY | SQLite::OPEN_URI | SQLite::OPEN_NOMUTEX);
+        //  deserializing takes the connection off its file or out of its shared cache, they are written through the
+        //  backup API instead
+        if (!db_full_path.empty() && db_full_path != ":memory:")
+            return copy_pages(source.getHandle(), database->getHandle(), -1, {}, {});
+
+        sqlite3_int64 size = 0;
+        //  read through the pager, pages still in the -wal file are part of the image
+        unsigned char *image = sqlite3_serialize(source.getHandle(), "main", &size, 0);
+        if (!image)
+            throw SQLite::Exception("couldn't read " + path);
+
+        //  a WAL image is read only once deserialized, the in memory copy uses a rollback journal
+        if (size >= 20)
+            image[18] = image[19] = 1;
+        //  sqlite owns the image from here on, also if deserializing fails
+        if (sqlite3_deserialize(database->getHandle(), "main", image, size, size,
+                                SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE) != SQLITE_OK)
+            throw SQLite::Exception(sqlite3_errmsg(database->getHandle()));
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::load_from_file -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::save_to_file(const std::string &path) {
+    if (!database)
+        return false;
+
+    try {
+        SQLite::Database destination(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_URI |
+                                           SQLite::OPEN_NOMUTEX);
+        return copy_pages(database->getHandle(), destination.getHandle(), -1, {}, {});
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::save_to_file -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::copy_pages(sqlite3 *source, sqlite3 *destination, int pages_per_step, std::chrono::milliseconds pause,
+                          const backup_progress_sink &progress) {
+    sqlite3_backup *backup = sqlite3_backup_init(destination, "main", source, "main");
+    if (!backup)
+        throw SQLite::Exception(sqlite3_errmsg(destination));
+
+    backup_progress state;
+    int result;
+    int locked_steps = 0;
+    do {
+        result = sqlite3_backup_step(backup, pages_per_step > 0 ? pages_per_step : -1);
+        locked_steps = result == SQLITE_BUSY || result == SQLITE_LOCKED ? locked_steps + 1 : 0;
+        const int remaining = sqlite3_backup_remaining(backup);
+        //  the source was written by another connection, sqlite starts over from the first page
+        if (result == SQLITE_OK && state.total_pages && remaining > state.remaining_pages)
+            ++state.restarts;
+        state.remaining_pages = remaining;
+        state.total_pages = sqlite3_backup_pagecount(backup);
+
+        if (progress && !progress(state))
+            break;
+        if (result != SQLITE_DONE && pause.count() > 0)
+            std::this_thread::sleep_for(pause);
+        //  BUSY and LOCKED are retried after the pause, the writer holding the lock is given it to finish, a lock
+        //  that outlasts backup_lock_retries pauses in a row isn't waited out any longer
+    } while (result == SQLITE_OK || (pause.count() > 0 && locked_steps > 0 && locked_steps < backup_lock_retries));
+
+    if (sqlite3_backup_finish(backup) != SQLITE_OK)
+        throw SQLite::Exception(sqlite3_errmsg(destination));
+    return result == SQLITE_DONE;
+}
+
 /**
  * @brief dont delete is used for DBHelper::create()
  */
@@ -222,10 +1090,104 @@ std::string DBHelper::assign_value(type t) {
 }
 
 bool DBHelper::table_empty(const std::string &table_name) {
-    int count = database->execAndGet(mutl::concatenate(
-            "SELECT COUNT(*) FROM ", table_name)).getInt();
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT EXISTS(SELECT 1 FROM ", table_name, " LIMIT 1)"));
+        query->executeStep();
+        bool empty = query->getColumn(0).getInt() == 0;
+        query->reset();
+        return empty;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::table_empty -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+long long DBHelper::row_count(const std::string &table_name, count_mode mode) {
+    try {
+        if (table_exists("dbhelper_row_counts")) {
+            std::shared_ptr<SQLite::Statement> query = prepare(
+                    "SELECT row_count FROM dbhelper_row_counts WHERE table_name=?");
+            query->bind(1, table_name);
+            if (query->executeStep()) {
+                long long count = query->getColumn(0).getInt64();
+                query->reset();
+                return count;
+            }
+        }
+
+        if (mode == ESTIMATE && table_exists("sqlite_stat1")) {
+            //  the first number of every stat row is the estimated row count, the table's own row if it has no index
+            std::shared_ptr<SQLite::Statement> query = prepare(
+                    "SELECT stat FROM sqlite_stat1 WHERE tbl=? ORDER BY idx IS NOT NULL LIMIT 1");
+            query->bind(1, table_name);
+            if (query->executeStep()) {
+                long long count = std::stoll(query->getColumn(0).getString());
+                query->reset();
+                return count;
+            }
+        }
+
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate("SELECT COUNT(*) FROM ", table_name));
+        query->executeStep();
+        long long count = query->getColumn(0).getInt64();
+        query->reset();
+        return count;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::row_count -> " << e.what() << std::endl;
+        return -1;
+    } catch (std::logic_error &e) {
+        std::cerr << "DBHelper::row_count -> " << "malformed sqlite_stat1 row: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+bool DBHelper::track_row_count(const std::string &table_name) {
+    try {
+        Savepoint savepoint(*this);
+        if (!savepoint.is_active())
+            return false;
+
+        database->exec("CREATE TABLE IF NOT EXISTS dbhelper_row_counts "
+                       "(table_name TEXT PRIMARY KEY, row_count INTEGER NOT NULL) WITHOUT ROWID");
+        database->exec(mutl::concatenate(
+                "CREATE TRIGGER IF NOT EXISTS dbhelper_count_", table_name, "_insert AFTER INSERT ON ", table_name,
+                " BEGIN UPDATE dbhelper_row_counts SET row_count=row_count+1 WHERE table_name='", table_name,
+                "'; END"));
+        database->exec(mutl::concatenate(
+                "CREATE TRIGGER IF NOT EXISTS dbhelper_count_", table_name, "_delete AFTER DELETE ON ", table_name,
+                " BEGIN UPDATE dbhelper_row_counts SET row_count=row_count-1 WHERE table_name='", table_name,
+                "'; END"));
+
+        //  one last full count, from here on the triggers keep it
+        SQLite::Statement query(*database, mutl::concatenate(
+                "INSERT OR REPLACE INTO dbhelper_row_counts (table_name, row_count) SELECT ?, COUNT(*) FROM ",
+                table_name));
+        query.bind(1, table_name);
+        query.exec();
+
+        return savepoint.release();
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::track_row_count -> " << e.what() << std::endl;
+        return false;
+    }
+}
 
-    return count == 0;
+bool DBHelper::untrack_row_count(const std::string &table_name) {
+    try {
+        reset_statement_cache();
+        database->exec(mutl::concatenate("DROP TRIGGER IF EXISTS dbhelper_count_", table_name, "_insert"));
+        database->exec(mutl::concatenate("DROP TRIGGER IF EXISTS dbhelper_count_", table_name, "_delete"));
+        if (table_exists("dbhelper_row_counts")) {
+            SQLite::Statement query(*database, "DELETE FROM dbhelper_row_counts WHERE table_name=?");
+            query.bind(1, table_name);
+            query.exec();
+        }
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::untrack_row_count -> " << e.what() << std::endl;
+        return false;
+    }
 }
 
 std::string DBHelper::intersected_questionmarks(int num) {
@@ -240,4 +1202,1021 @@ std::string DBHelper::intersected_questionmarks(int num) {
             result.append(", ?");
 
     return result;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<SQLite::Statement> DBHelper::prepare(const std::string &sql) {
+    if (!slow_queries.empty())
+        flush_slow_queries();
+
+    auto cached = statement_cache_index.find(sql);
+    if (cached != statement_cache_index.end()) {
+        std::shared_ptr<SQLite::Statement> &query = cached->second->second;
+        //  the cache holds the only reference, nobody is stepping through it
+        if (query.use_count() == 1) {
+            statement_cache.splice(statement_cache.begin(), statement_cache, cached->second);
+            try {
+                query->reset();
+            } catch (SQLite::Exception &e) {
+                //  reset() rethrows the error of the last failed step, the statement is reset anyway
+            }
+            query->clearBindings();
+            ++cache_stats.hits;
+            return lend_statement(query);
+        }
+
+        ++cache_stats.misses;
+        return compile(sql);
+    }
+
+    ++cache_stats.misses;
+    std::shared_ptr<SQLite::Statement> query = compile(sql);
+    if (statement_cache_capacity == 0)
+        return query;
+
+    statement_cache.emplace_front(sql, query);
+    statement_cache_index.emplace(statement_cache.front().first, statement_cache.begin());
+    evict_statements(statement_cache_capacity);
+
+    return lend_statement(query);
+}
+
+std::shared_ptr<SQLite::Statement> DBHelper::lend_statement(const std::shared_ptr<SQLite::Statement> &query) {
+    //  a statement dropped mid-step keeps its read lock or WAL snapshot until it's reset, the cache wouldn't do that
+    //  before the same sql runs again, the handle resets it once the caller lets go, the copy keeps an evicted
+    //  statement alive until then
+    return {query.get(), [owner = query](SQLite::Statement *statement) {
+        try {
+            statement->reset();
+        } catch (SQLite::Exception &e) {
+            //  reset() rethrows the error of the last failed step, the statement is reset anyway
+        }
+    }};
+}
+
+std::shared_ptr<SQLite::Statement> DBHelper::compile(const std::string &sql) {
+#ifndef DBHELPER_NO_INSTRUMENTATION
+    if (instrumentation) {
+        auto begin = std::chrono::steady_clock::now();
+        std::shared_ptr<SQLite::Statement> query = std::make_shared<SQLite::Statement>(*database, sql);
+        auto end = std::chrono::steady_clock::now();
+        stats_by_sql[sql].prepare_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        return query;
+    }
+#endif
+    return std::make_shared<SQLite::Statement>(*database, sql);
+}
+
+void DBHelper::evict_statements(size_t capacity) {
+    while (statement_cache.size() > capacity) {
+        statement_cache_index.erase(statement_cache.back().first);
+        statement_cache.pop_back();
+        ++cache_stats.evictions;
+    }
+}
+
+void DBHelper::set_statement_cache_capacity(size_t capacity) {
+    statement_cache_capacity = capacity;
+    evict_statements(capacity);
+}
+
+void DBHelper::clear_statement_cache() {
+    statement_cache_index.clear();
+    statement_cache.clear();
+}
+
+void DBHelper::reset_statement_cache() {
+    for (auto &[sql, query]: statement_cache) {
+        if (query.use_count() != 1)
+            continue;
+        try {
+            query->reset();
+        } catch (SQLite::Exception &e) {
+            //  see DBHelper::prepare
+        }
+    }
+}
+
+bool DBHelper::begin(transaction_type behavior) {
+    try {
+        switch (behavior) {
+            case DEFERRED:
+                prepare("BEGIN DEFERRED TRANSACTION")->exec();
+                break;
+            case IMMEDIATE:
+                prepare("BEGIN IMMEDIATE TRANSACTION")->exec();
+                break;
+            case EXCLUSIVE:
+                prepare("BEGIN EXCLUSIVE TRANSACTION")->exec();
+                break;
+            default:
+                throw SQLite::Exception("tried to use nonexistent enum transaction_type");
+        }
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::begin -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::commit() {
+    try {
+        prepare("COMMIT TRANSACTION")->exec();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::commit -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::rollback() {
+    try {
+        reset_statement_cache();
+        prepare("ROLLBACK TRANSACTION")->exec();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::rollback -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::savepoint(const std::string &name) {
+    try {
+        prepare("SAVEPOINT " + name)->exec();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::savepoint -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::release(const std::string &name) {
+    try {
+        prepare("RELEASE SAVEPOINT " + name)->exec();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::release -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::rollback_to(const std::string &name) {
+    try {
+        reset_statement_cache();
+        prepare("ROLLBACK TO SAVEPOINT " + name)->exec();
+        //  sqlite only calls the rollback hook when the whole transaction is rolled back
+        rollback_hook(db_connection.get());
+        //  the schema version goes back to the one of the savepoint, it can come up again with another schema
+        clear_schema_cache();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::rollback_to -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DBHelper::in_transaction() {
+    return sqlite3_get_autocommit(database->getHandle()) == 0;
+}
+
+DBHelper::Transaction::Transaction(DBHelper &db_helper, transaction_type behavior)
+        : db_helper(db_helper) {
+    active = db_helper.begin(behavior);
+}
+
+DBHelper::Transaction::~Transaction() {
+    if (active)
+        db_helper.rollback();
+}
+
+bool DBHelper::Transaction::commit() {
+    if (!active)
+        return false;
+
+    active = !db_helper.commit();
+    return !active;
+}
+
+bool DBHelper::Transaction::rollback() {
+    if (!active)
+        return false;
+
+    active = false;
+    return db_helper.rollback();
+}
+
+DBHelper::Savepoint::Savepoint(DBHelper &db_helper)
+        : db_helper(db_helper),
+          name(mutl::concatenate("dbhelper_savepoint_", db_helper.db_connection ? db_helper.db_connection->savepoint_depth : 0)) {
+    active = db_helper.savepoint(name);
+    if (active)
+        ++db_helper.db_connection->savepoint_depth;
+}
+
+DBHelper::Savepoint::~Savepoint() {
+    if (active)
+        rollback();
+}
+
+bool DBHelper::Savepoint::release() {
+    //  a failed RELEASE leaves the savepoint open, the guard still has to roll it back
+    if (!active || !db_helper.release(name))
+        return false;
+
+    active = false;
+    --db_helper.db_connection->savepoint_depth;
+    return true;
+}
+
+bool DBHelper::Savepoint::rollback() {
+    if (!active)
+        return false;
+
+    active = false;
+    --db_helper.db_connection->savepoint_depth;
+    //  ROLLBACK TO keeps the savepoint on the stack, it still has to be released
+    return db_helper.rollback_to(name) && db_helper.release(name);
+}
+
+std::string DBHelper::multi_row_insert_sql(const std::string &table_name, const std::vector<std::string> &columns,
+                                           size_t row_count) {
+    std::string row = '(' + intersected_questionmarks(static_cast<int>(columns.size())) + ')';
+
+    std::string sql = mutl::concatenate(
+            "INSERT INTO ", table_name,
+            " (", mutl::format_with_comma<std::string>(columns),
+            ") VALUES ");
+    sql.reserve(sql.size() + row_count * (row.size() + 2));
+    sql.append(row);
+    for (size_t i = 1; i < row_count; ++i)
+        sql.append(", ").append(row);
+
+    return sql;
+}
+
+size_t DBHelper::max_rows_per_statement(size_t column_count) {
+    //  keeps statements small enough to prepare quickly even if the variable limit is raised
+    constexpr size_t max_rows = 500;
+    if (column_count == 0)
+        return max_rows;
+
+    auto variable_limit = static_cast<size_t>(sqlite3_limit(database->getHandle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+    return std::clamp<size_t>(variable_limit / column_count, 1, max_rows);
+}
+
+DBHelper::options DBHelper::options::of(profile p) {
+    options opts;
+    opts.journal_mode = "WAL";
+    opts.temp_store = "MEMORY";
+    opts.busy_timeout = 5000;
+
+    switch (p) {
+        case DURABLE:
+            opts.synchronous = "FULL";
+            opts.temp_store = "DEFAULT";
+            opts.cache_size = -2000;
+            opts.mmap_size = 0;
+            break;
+        case BALANCED:
+            opts.synchronous = "NORMAL";
+            opts.cache_size = -16000;
+            opts.mmap_size = 256LL * 1024 * 1024;
+            break;
+        case BULK_LOAD:
+            opts.synchronous = "OFF";
+            opts.cache_size = -256000;
+            opts.mmap_size = 256LL * 1024 * 1024;
+            break;
+        case READ_MOSTLY:
+            opts.synchronous = "NORMAL";
+            opts.cache_size = -64000;
+            opts.mmap_size = 1024LL * 1024 * 1024;
+            break;
+        default:
+            throw SQLite::Exception("tried to use nonexistent enum profile");
+    }
+    return opts;
+}
+
+bool DBHelper::configure(const options &opts) {
+    try {
+        bool applied = true;
+        if (!opts.journal_mode.empty()) {
+            //  sqlite answers with the mode it ended up in instead of failing, in memory databases can't use WAL
+            //  and a WAL database can't leave it while other connections have it open
+            std::string mode = database->execAndGet("PRAGMA journal_mode=" + opts.journal_mode).getString();
+            if (!std::equal(mode.begin(), mode.end(), opts.journal_mode.begin(), opts.journal_mode.end(),
+                            [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); })) {
+                std::cerr << "DBHelper::configure -> journal_mode " << opts.journal_mode << " not applied, still "
+                          << mode << std::endl;
+                applied = false;
+            }
+        }
+        if (!opts.synchronous.empty())
+            database->exec("PRAGMA synchronous=" + opts.synchronous);
+        if (opts.cache_size != 0)
+            database->exec(mutl::concatenate("PRAGMA cache_size=", opts.cache_size));
+        if (opts.mmap_size >= 0)
+            database->exec(mutl::concatenate("PRAGMA mmap_size=", opts.mmap_size));
+        if (!opts.temp_store.empty())
+            database->exec("PRAGMA temp_store=" + opts.temp_store);
+        if (opts.busy_timeout >= 0)
+            database->setBusyTimeout(opts.busy_timeout);
+        return applied;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::configure -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+DBHelper::Cursor &DBHelper::Cursor::operator=(Cursor &&other) noexcept {
+    if (this != &other) {
+        release();
+        query = std::move(other.query);
+        row_indexes = std::move(other.row_indexes);
+        row_indexes_of = other.row_indexes_of;
+    }
+    return *this;
+}
+
+DBHelper::Cursor::~Cursor() { release(); }
+
+bool DBHelper::Cursor::step() {
+    if (!query)
+        return false;
+
+    try {
+        return query->executeStep();
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::Cursor::step -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void DBHelper::Cursor::release() {
+    if (!query)
+        return;
+
+    try {
+        //  a cached statement left mid-step would keep its read lock
+        query->reset();
+    } catch (SQLite::Exception &e) {
+        //  see DBHelper::prepare
+    }
+    query.reset();
+}
+
+std::string DBHelper::create_index(const std::string &index_name, const std::string &table_name,
+                                   const std::vector<std::string> &columns,
+                                   const std::vector<std::string> &covered_columns,
+                                   const std::string &where,
+                                   bool unique) {
+    if (columns.empty()) {
+        std::cerr << "DBHelper::create_index -> " << "needs at least one column" << std::endl;
+        return {};
+    }
+
+    try {
+        std::vector<std::string> indexed = columns;
+        indexed.insert(indexed.end(), covered_columns.begin(), covered_columns.end());
+
+        std::string sql = mutl::concatenate(
+                unique ? "CREATE UNIQUE INDEX IF NOT EXISTS " : "CREATE INDEX IF NOT EXISTS ", index_name,
+                " ON ", table_name,
+                " (", mutl::format_with_comma<std::string>(indexed), ")",
+                where.empty() ? "" : " WHERE ", where);
+        database->exec(sql);
+        return sql;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::create_index -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+std::string DBHelper::drop_index(const std::string &index_name) {
+    try {
+        std::string sql = "DROP INDEX IF EXISTS " + index_name;
+        reset_statement_cache();
+        database->exec(sql);
+        return sql;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::drop_index -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+std::optional<DBHelper::index_advice> DBHelper::advise_index(const std::string &sql, bool auto_create) {
+    //  the WHERE clause generated by format_into_question_mark_equation_logic: column op ? [AND column op ?]...
+    size_t where = sql.find(" WHERE ");
+    if (where == std::string::npos)
+        return {};
+
+    try {
+        index_advice advice;
+        //  statements are explained, not executed, so they don't have to be bound
+        SQLite::Statement plan(*database, "EXPLAIN QUERY PLAN " + sql);
+        while (plan.executeStep()) {
+            std::string detail = plan.getColumn(3).getString();
+            //  "SCAN users" since sqlite 3.36, "SCAN TABLE users" before
+            if (detail.rfind("SCAN ", 0) != 0)
+                continue;
+
+            std::stringstream ss(detail.substr(5));
+            ss >> advice.table_name;
+            if (advice.table_name == "TABLE")
+                ss >> advice.table_name;
+            advice.plan = detail;
+            break;
+        }
+        if (advice.plan.empty())
+            return {};
+
+        std::vector<std::string> ranges;
+        std::string conditions = sql.substr(where + 7);
+        for (size_t begin = 0, end; begin < conditions.size(); begin = end + 5) {
+            end = std::min(conditions.find(" AND ", begin), conditions.size());
+            std::string condition = conditions.substr(begin, end - begin);
+            size_t op = condition.find_first_of("=<>! ");
+            if (op == std::string::npos || op == 0)
+                continue;
+
+            std::string column = condition.substr(0, op);
+            bool equality = condition.compare(op, 2, "=?") == 0 || condition.compare(op, 3, "==?") == 0;
+            std::vector<std::string> &target = equality ? advice.columns : ranges;
+            if (std::find(target.begin(), target.end(), column) == target.end())
+                target.push_back(column);
+        }
+        //  an index can only be searched by equality columns followed by at most one range column
+        if (!ranges.empty() && std::find(advice.columns.begin(), advice.columns.end(), ranges.front()) == advice.columns.end())
+            advice.columns.push_back(ranges.front());
+        if (advice.columns.empty())
+            return {};
+
+        std::string index_name = "dbhelper_idx_" + advice.table_name;
+        for (const std::string &column: advice.columns)
+            index_name.append("_").append(column);
+
+        advice.sql = sql;
+        advice.create_sql = mutl::concatenate(
+                "CREATE INDEX IF NOT EXISTS ", index_name,
+                " ON ", advice.table_name,
+                " (", mutl::format_with_comma<std::string>(advice.columns), ")");
+        if (auto_create)
+            create_index(index_name, advice.table_name, advice.columns);
+
+        return advice;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::advise_index -> " << e.what() << std::endl;
+        return {};
+    }
+}
+
+std::vector<DBHelper::index_advice> DBHelper::advise_indexes(bool auto_create) {
+    std::vector<index_advice> result;
+    for (const auto &[sql, query]: statement_cache) {
+        if (sql.rfind("SELECT ", 0) != 0 && sql.rfind("DELETE ", 0) != 0 && sql.rfind("UPDATE ", 0) != 0)
+            continue;
+
+        std::optional<index_advice> advice = advise_index(sql, auto_create);
+        if (advice)
+            result.push_back(std::move(*advice));
+    }
+    return result;
+}
+
+bool DBHelper::enable_bloom_filter(const std::string &table_name, const std::string &column,
+                                   size_t expected_values, double false_positive_rate) {
+    if (!database)
+        return false;
+
+    try {
+        std::shared_ptr<const table_schema> schema = get_schema(table_name);
+        int index = schema ? schema->column_index(column) : -1;
+        if (index < 0) {
+            std::cerr << "DBHelper::enable_bloom_filter -> " << "no such column: " << table_name << '.' << column
+                      << std::endl;
+            return false;
+        }
+
+        //  affinity rules of https://www.sqlite.org/datatype3.html#determination_of_column_affinity
+        std::string type = schema->columns[index].declared_type;
+        std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+        bool integer_affinity = type.find("INT") != std::string::npos;
+        bool text_affinity = !integer_affinity && (type.find("CHAR") != std::string::npos ||
+                                                   type.find("CLOB") != std::string::npos ||
+                                                   type.find("TEXT") != std::string::npos);
+        if (!integer_affinity && !text_affinity) {
+            std::cerr << "DBHelper::enable_bloom_filter -> " << "unsupported column type: " << type << std::endl;
+            return false;
+        }
+
+        //  the filter hashes the exact bytes, a column compared under any other collation ('a' = 'A' with NOCASE)
+        //  would have exists() report values missing that the column matches
+        const char *collation = nullptr;
+        if (sqlite3_table_column_metadata(database->getHandle(), nullptr, table_name.c_str(),
+                                          schema->columns[index].name.c_str(), nullptr, &collation, nullptr, nullptr,
+                                          nullptr) != SQLITE_OK)
+            throw SQLite::Exception(sqlite3_errmsg(database->getHandle()));
+        if (collation && sqlite3_stricmp(collation, "BINARY") != 0) {
+            std::cerr << "DBHelper::enable_bloom_filter -> " << "unsupported column collation: " << collation
+                      << std::endl;
+            return false;
+        }
+
+        std::string table = table_name;
+        std::transform(table.begin(), table.end(), table.begin(), [](unsigned char c) { return std::tolower(c); });
+        expected_values = std::max<size_t>(expected_values, 1);
+        db_connection->bloom_filters.insert_or_assign(
+                mutl::concatenate(table_name, '.', column),
+                column_filter{BloomFilter(expected_values, false_positive_rate), expected_values,
+                              false_positive_rate, integer_affinity, std::move(table)});
+        update_hooks();
+        return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::enable_bloom_filter -> " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void DBHelper::disable_bloom_filter(const std::string &table_name, const std::string &column) {
+    if (!database)
+        return;
+
+    db_connection->bloom_filters.erase(mutl::concatenate(table_name, '.', column));
+    update_hooks();
+}
+
+void DBHelper::rebuild_bloom_filter(const std::string &table_name, const std::string &column) {
+    if (!database)
+        return;
+
+    auto it = db_connection->bloom_filters.find(mutl::concatenate(table_name, '.', column));
+    if (it != db_connection->bloom_filters.end())
+        it->second.populated = false;
+}
+
+DBHelper::column_filter *DBHelper::bloom_filter(const std::string &table_name, std::string_view column) {
+    auto it = db_connection->bloom_filters.find(mutl::concatenate(table_name, '.', column));
+    if (it == db_connection->bloom_filters.end())
+        return nullptr;
+
+    column_filter &filter = it->second;
+    if (filter.populated && !filter.written_rowids.empty())
+        add_written_rows(table_name, column, filter);
+    if (!filter.populated)
+        populate_bloom_filter(table_name, column, filter);
+    return filter.populated ? &filter : nullptr;
+}
+
+void DBHelper::populate_bloom_filter(const std::string &table_name, std::string_view column, column_filter &filter) {
+    try {
+        //  read before the table, a commit landing in between only costs another refill
+        sqlite3 *handle = database->getHandle();
+        filter.data_version = data_version();
+        filter.checked_total_changes = sqlite3_total_changes64(handle);
+        filter.checked_hooked_changes = db_connection->hooked_changes;
+        filter.written_rowids.clear();
+
+        SQLite::Statement count(*database, mutl::concatenate("SELECT COUNT(*) FROM ", table_name));
+        count.executeStep();
+        //  leave room to grow so a filling table doesn't rebuild on every few inserts
+        filter.expected_values = std::max(filter.expected_values,
+                                          2 * static_cast<size_t>(count.getColumn(0).getInt64()));
+        filter.filter = BloomFilter(filter.expected_values, filter.false_positive_rate);
+
+        SQLite::Statement query(*database, mutl::concatenate("SELECT ", column, " FROM ", table_name));
+        while (query.executeStep())
+            add_column_value(filter, query.getColumn(0));
+        filter.populated = true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::populate_bloom_filter -> " << e.what() << std::endl;
+        filter.populated = false;
+    }
+}
+
+void DBHelper::add_written_rows(const std::string &table_name, std::string_view column, column_filter &filter) {
+    try {
+        std::shared_ptr<SQLite::Statement> query = prepare(mutl::concatenate(
+                "SELECT ", column, " FROM ", table_name, " WHERE rowid=?"));
+        for (int64_t rowid: filter.written_rowids) {
+            query->bind(1, rowid);
+            //  rows deleted or rolled back since are gone, their values stay in the filter as false positives
+            if (query->executeStep())
+                add_column_value(filter, query->getColumn(0));
+            query->reset();
+        }
+        filter.written_rowids.clear();
+
+        //  past twice the expected size the false positive rate climbs fast, refill a bigger filter
+        if (filter.filter.size() > 2 * filter.expected_values)
+            filter.populated = false;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::add_written_rows -> " << e.what() << std::endl;
+        filter.populated = false;
+    }
+}
+
+void DBHelper::add_column_value(column_filter &filter, const SQLite::Column &value) {
+    if (value.isInteger())
+        filter.filter.add(value.getString());
+    else if (value.isText() && !filter.integer_affinity)
+        filter.filter.add(std::string_view(value.getText(), value.getBytes()));
+    else if (value.isFloat() && filter.integer_affinity) {
+        double number = value.getDouble();
+        if (number == std::trunc(number) && std::abs(number) < 9.2e18)
+            filter.filter.add(std::to_string(static_cast<long long>(number)));
+    }
+    //  blobs are never converted and can't equal an integer or text lookup
+}
+
+bool DBHelper::bloom_filter_current(column_filter &filter) {
+    try {
+        int64_t unhooked = sqlite3_total_changes64(database->getHandle()) - filter.checked_total_changes -
+                           (db_connection->hooked_changes - filter.checked_hooked_changes);
+        if (unhooked == 0 && data_version() == filter.data_version)
+            return true;
+    } catch (SQLite::Exception &e) {
+        std::cerr << "DBHelper::bloom_filter_current -> " << e.what() << std::endl;
+    }
+    filter.populated = false;
+    return false;
+}
+
+int64_t DBHelper::data_version() {
+    std::unique_ptr<SQLite::Statement> &query = db_connection->data_version_query;
+    if (!query)
+        query = std::make_unique<SQLite::Statement>(*database, "PRAGMA data_version");
+    query->executeStep();
+    int64_t version = query->getColumn(0).getInt64();
+    query->reset();
+    return version;
+}
+
+void DBHelper::enable_instrumentation(bool enabled) {
+#ifndef DBHELPER_NO_INSTRUMENTATION
+    instrumentation = enabled;
+    update_trace_callback();
+#endif
+}
+
+void DBHelper::update_trace_callback() {
+    if (!database)
+        return;
+
+    //  addresses of statements finalized while the callback was off may have been reused
+    stats_by_statement.clear();
+    //  the connection has one trace callback, it serves every DBHelper sharing it
+    unsigned events = 0;
+    for (DBHelper *helper: db_connection->helpers)
+        events |= (helper->instrumentation ? SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW : 0) |
+                  (helper->slow_query_threshold.count() >= 0 ? SQLITE_TRACE_PROFILE : 0);
+    if (events)
+        sqlite3_trace_v2(database->getHandle(), events, trace_callback, db_connection.get());
+    else
+        sqlite3_trace_v2(database->getHandle(), 0, nullptr, nullptr);
+}
+
+void DBHelper::reset_query_stats() {
+    stats_by_statement.clear();
+    stats_by_sql.clear();
+}
+
+int DBHelper::trace_callback(unsigned event, void *context, void *p, void *x) {
+    auto *opened = static_cast<connection *>(context);
+    auto *statement = static_cast<sqlite3_stmt *>(p);
+    //  read once for every DBHelper of the connection, reading resets them
+    std::optional<std::array<int, 4>> counters;
+
+    for (DBHelper *helper: opened->helpers) {
+        if (helper->instrumentation) {
+            traced_statement &traced = helper->stats_of(statement);
+            query_stats &stats = *traced.stats;
+
+            if (event == SQLITE_TRACE_ROW) {
+                ++stats.rows;
+                continue;
+            }
+
+            //  SQLITE_TRACE_PROFILE, the statement finished and x points to its run time
+            auto ns = static_cast<uint64_t>(*static_cast<sqlite3_int64 *>(x));
+            ++stats.calls;
+            stats.step_ns += ns;
+            if (traced.changes_rows)
+                stats.rows += sqlite3_changes(sqlite3_db_handle(statement));
+
+            size_t bucket = 0;
+            for (uint64_t us = ns / 1000; us >= 2 && bucket < stats.histogram.size() - 1; us >>= 1)
+                ++bucket;
+            ++stats.histogram[bucket];
+        }
+
+        if (event == SQLITE_TRACE_PROFILE && helper->slow_query_threshold.count() >= 0 &&
+            !helper->flushing_slow_queries) {
+            std::chrono::nanoseconds elapsed(*static_cast<sqlite3_int64 *>(x));
+            //  counters add up over every run of a cached statement, reset them so they only cover this one
+            if (!counters)
+                counters = {sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1),
+                            sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_SORT, 1),
+                            sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_AUTOINDEX, 1),
+                            sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_VM_STEP, 1)};
+            if (elapsed < helper->slow_query_threshold)
+                continue;
+
+            const char *sql = sqlite3_sql(statement);
+            char *expanded = sqlite3_expanded_sql(statement);
+            auto [fullscan_steps, sorts, autoindex_rows, vm_steps] = *counters;
+            helper->slow_queries.push_back({sql ? sql : "", expanded ? expanded : "", elapsed,
+                                            fullscan_steps, sorts, autoindex_rows, vm_steps, {}});
+            sqlite3_free(expanded);
+        }
+    }
+    return 0;
+}
+
+DBHelper::traced_statement &DBHelper::stats_of(sqlite3_stmt *statement) {
+    const char *sql = sqlite3_sql(statement);
+    if (!sql)
+        sql = "";
+
+    auto it = stats_by_statement.find(statement);
+    if (it != stats_by_statement.end() && *it->second.sql == sql)
+        return it->second;
+
+    auto stats = stats_by_sql.try_emplace(sql).first;
+    std::string_view keyword(sql, std::min<size_t>(std::strlen(sql), 7));
+    bool changes_rows = false;
+    for (std::string_view dml: {"INSERT", "UPDATE", "DELETE", "REPLACE"})
+        changes_rows |= keyword.size() >= dml.size() &&
+                        std::equal(dml.begin(), dml.end(), keyword.begin(),
+                                   [](char a, char b) { return a == std::toupper(static_cast<unsigned char>(b)); });
+
+    traced_statement &traced = stats_by_statement[statement];
+    traced = {&stats->first, &stats->second, changes_rows};
+    return traced;
+}
+
+uint64_t DBHelper::query_stats::percentile_us(double percentile) const {
+    size_t total = 0;
+    for (size_t count: histogram)
+        total += count;
+    if (total == 0)
+        return 0;
+
+    auto target = static_cast<size_t>(std::ceil(percentile * static_cast<double>(total)));
+    size_t seen = 0;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        seen += histogram[i];
+        if (seen >= std::max<size_t>(target, 1))
+            return uint64_t(1) << (i + 1);
+    }
+    return uint64_t(1) << histogram.size();
+}
+
+
+std::string DBHelper::dump_query_stats(dump_format format) const {
+    std::vector<std::pair<const std::string *, const query_stats *>> sorted;
+    sorted.reserve(stats_by_sql.size());
+    for (const auto &[sql, stats]: stats_by_sql)
+        sorted.emplace_back(&sql, &stats);
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second->step_ns > b.second->step_ns;
+    });
+
+    std::ostringstream out;
+    if (format == PLAIN_TEXT) {
+        out << "calls\trows\tprepare_ms\tstep_ms\tp50_us\tp99_us\tsql\n";
+        for (const auto &[sql, stats]: sorted)
+            out << stats->calls << '\t' << stats->rows << '\t'
+                << static_cast<double>(stats->prepare_ns) / 1e6 << '\t'
+                << static_cast<double>(stats->step_ns) / 1e6 << '\t'
+                << stats->percentile_us(0.5) << '\t' << stats->percentile_us(0.99) << '\t'
+                << *sql << '\n';
+        return out.str();
+    }
+
+    out << '[';
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const query_stats &stats = *sorted[i].second;
+        out << (i ? ",\n " : "") << "{\"sql\": \"" << json_escape(*sorted[i].first)
+            << "\", \"calls\": " << stats.calls << ", \"rows\": " << stats.rows
+            << ", \"prepare_ns\": " << stats.prepare_ns << ", \"step_ns\": " << stats.step_ns
+            << ", \"p50_us\": " << stats.percentile_us(0.5) << ", \"p99_us\": " << stats.percentile_us(0.99)
+            << ", \"histogram_us\": [";
+        size_t used = stats.histogram.size();
+        while (used > 0 && stats.histogram[used - 1] == 0)
+            --used;
+        for (size_t bucket = 0; bucket < used; ++bucket)
+            out << (bucket ? ", " : "") << stats.histogram[bucket];
+        out << "]}";
+    }
+    out << "]\n";
+    return out.str();
+}
+
+void DBHelper::set_slow_query_log(std::chrono::nanoseconds threshold, slow_query_sink sink) {
+    slow_query_threshold = std::max(threshold, std::chrono::nanoseconds(0));
+    slow_query_log = sink ? std::move(sink) : [](const slow_query &query) {
+        std::cerr << "DBHelper::slow_query -> "
+                  << std::chrono::duration<double, std::milli>(query.elapsed).count() << " ms, "
+                  << query.fullscan_steps << " full scan steps, " << query.sorts << " sorts: "
+                  << query.expanded_sql << '\n' << query.plan << std::endl;
+    };
+    update_trace_callback();
+}
+
+void DBHelper::disable_slow_query_log() {
+    flush_slow_queries();
+    slow_query_threshold = std::chrono::nanoseconds(-1);
+    slow_query_log = nullptr;
+    update_trace_callback();
+}
+
+void DBHelper::flush_slow_queries() {
+    if (slow_queries.empty() || flushing_slow_queries)
+        return;
+
+    //  anything escaping the loop (std::bad_alloc) would otherwise leave the log muted for good
+    struct flushing_guard {
+        bool &flushing;
+        ~flushing_guard() { flushing = false; }
+    } guard{flushing_slow_queries};
+    flushing_slow_queries = true;
+    std::vector<slow_query> captured;
+    captured.swap(slow_queries);
+    for (slow_query &query: captured) {
+        try {
+            SQLite::Statement explain(*database, "EXPLAIN QUERY PLAN " + query.sql);
+            //  id, parent, notused, detail, children always come after their parent
+            std::unordered_map<int, int> depth;
+            while (explain.executeStep()) {
+                int id = explain.getColumn(0).getInt();
+                auto parent = depth.find(explain.getColumn(1).getInt());
+                int level = parent == depth.end() ? 0 : parent->second + 1;
+                depth[id] = level;
+                query.plan.append(2 * level, ' ').append(explain.getColumn(3).getString()).append("\n");
+            }
+        } catch (SQLite::Exception &e) {
+            query.plan = std::string("no plan: ") + e.what();
+        }
+
+        //  the sink is user code, it may throw from the destructor or from inside a call that only expects
+        //  SQLite::Exception, the remaining queries are still reported
+        try {
+            if (slow_query_log)
+                slow_query_log(query);
+        } catch (std::exception &e) {
+            std::cerr << "DBHelper::flush_slow_queries -> " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "DBHelper::flush_slow_queries -> unknown exception thrown by the sink" << std::endl;
+        }
+    }
+}
+
+void DBHelper::enable_result_cache(size_t max_bytes, std::chrono::milliseconds max_staleness) {
+    if (max_bytes == 0) {
+        disable_result_cache();
+        return;
+    }
+
+    result_cache_capacity = max_bytes;
+    result_cache_staleness = max_staleness;
+    evict_results(max_bytes);
+    if (!database)
+        return;
+
+    update_hooks();
+    checked_hooked_changes = db_connection->hooked_changes;
+    checked_total_changes = sqlite3_total_changes64(database->getHandle());
+}
+
+void DBHelper::disable_result_cache() {
+    clear_result_cache();
+    result_cache_capacity = 0;
+    if (database)
+        update_hooks();
+}
+
+void DBHelper::update_hooks() {
+    //  like the trace callback the hooks belong to the connection, they serve every DBHelper caching on it and the
+    //  connection's Bloom filters
+    bool caching = !db_connection->bloom_filters.empty() ||
+                   std::any_of(db_connection->helpers.begin(), db_connection->helpers.end(),
+                               [](const DBHelper *helper) { return helper->result_cache_capacity > 0; });
+    sqlite3 *handle = database->getHandle();
+    sqlite3_update_hook(handle, caching ? update_hook : nullptr, caching ? db_connection.get() : nullptr);
+    sqlite3_rollback_hook(handle, caching ? rollback_hook : nullptr, caching ? db_connection.get() : nullptr);
+}
+
+DBHelper::result_cache_stats DBHelper::get_result_cache_stats() const {
+    result_cache_stats stats = result_stats;
+    stats.entries = result_cache.size();
+    stats.memory_usage = result_cache_bytes;
+    return stats;
+}
+
+void DBHelper::clear_result_cache() {
+    result_cache_index.clear();
+    result_cache.clear();
+    result_cache_bytes = 0;
+}
+
+void DBHelper::validate_result_cache() {
+    sqlite3 *handle = database->getHandle();
+    int64_t total_changes = sqlite3_total_changes64(handle);
+    const int64_t hooked_changes = db_connection->hooked_changes;
+    bool unseen_changes = total_changes - checked_total_changes != hooked_changes - checked_hooked_changes;
+    checked_total_changes = total_changes;
+    checked_hooked_changes = hooked_changes;
+
+    //  the pager's counter is read without a transaction, it only moves once this connection starts one after a
+    //  commit, so another connection's commit can go unseen until the staleness bound runs out,
+    //  inside a transaction the read lock is held anyway and an uncommitted DROP or ALTER of this connection
+    //  doesn't move the counter, the pragmas are read every time
+    unsigned int file_version = 0;
+    sqlite3_file_control(handle, "main", SQLITE_FCNTL_DATA_VERSION, &file_version);
+    const auto now = std::chrono::steady_clock::now();
+    if (!unseen_changes && file_version == checked_file_version && sqlite3_get_autocommit(handle) &&
+        now - checked_at < result_cache_staleness)
+        return;
+
+    std::shared_ptr<SQLite::Statement> query = prepare(
+            "SELECT data_version, schema_version FROM pragma_data_version, pragma_schema_version");
+    query->executeStep();
+    int64_t data_version = query->getColumn(0).getInt64();
+    int64_t schema_version = query->getColumn(1).getInt64();
+    query->reset();
+
+    if (unseen_changes || data_version != checked_data_version || schema_version != checked_schema_version) {
+        result_stats.invalidations += result_cache.size();
+        clear_result_cache();
+    }
+    checked_data_version = data_version;
+    checked_schema_version = schema_version;
+    //  read again, the pragmas started a read transaction which brought it up to date
+    sqlite3_file_control(handle, "main", SQLITE_FCNTL_DATA_VERSION, &checked_file_version);
+    checked_at = now;
+}
+
+const uint64_t *DBHelper::table_generation(const std::string &table_name) {
+    //  sqlite matches table names case insensitively, the hook reports them as declared
+    std::string name = table_name;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return &table_generations.try_emplace(std::move(name), 0).first->second;
+}
+
+void DBHelper::store_result(const std::string &table_name, std::string key, std::any value, size_t bytes) {
+    //  the update hook names the tables written, the results of anything else couldn't be invalidated
+    if (bytes > result_cache_capacity || !table_exists(table_name))
+        return;
+
+    const uint64_t *generation = table_generation(table_name);
+    result_cache.push_front({std::move(key), std::move(value), generation, *generation, bytes});
+    result_cache_index.emplace(result_cache.front().key, result_cache.begin());
+    result_cache_bytes += bytes;
+    evict_results(result_cache_capacity);
+}
+
+void DBHelper::evict_results(size_t capacity) {
+    while (result_cache_bytes > capacity && !result_cache.empty()) {
+        result_cache_bytes -= result_cache.back().bytes;
+        result_cache_index.erase(result_cache.back().key);
+        result_cache.pop_back();
+        ++result_stats.evictions;
+    }
+}
+
+void DBHelper::update_hook(void *context, int operation, const char *, const char *table_name, long long rowid) {
+    std::string name = table_name;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    auto *opened = static_cast<connection *>(context);
+    ++opened->hooked_changes;
+    //  the hook can't run statements of its own, the values are read on the next exists()
+    if (operation != SQLITE_DELETE)
+        for (auto &[key, filter]: opened->bloom_filters) {
+            if (!filter.populated || filter.table != name)
+                continue;
+
+            filter.written_rowids.push_back(rowid);
+            //  past that many rows a refill is cheaper than looking each of them up
+            if (filter.written_rowids.size() > filter.expected_values) {
+                filter.populated = false;
+                filter.written_rowids.clear();
+            }
+        }
+
+    for (DBHelper *helper: opened->helpers) {
+        if (helper->result_cache_capacity == 0)
+            continue;
+
+        auto generation = helper->table_generations.find(name);
+        if (generation != helper->table_generations.end())
+            ++generation->second;
+    }
+}
+
+void DBHelper::rollback_hook(void *context) {
+    for (DBHelper *helper: static_cast<connection *>(context)->helpers) {
+        helper->result_stats.invalidations += helper->result_cache.size();
+        helper->clear_result_cache();
+    }
+}
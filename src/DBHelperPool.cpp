@@ -0,0 +1,117 @@
+//
+// Created by dawid on 17.10.2026.
+//
+
+#include <SQLiteCpp/Database.h>
+#include <sqlite3.h>
+
+#include "../include/DBHelperPool.h"
+
+
+DBHelperPool::DBHelperPool(const std::string &db_path, size_t reader_count, DBHelper::options opts) {
+    //  WAL lets the readers keep reading while the writer commits
+    opts.journal_mode = "WAL";
+    writer_helper = std::make_unique<DBHelper>(db_path, opts);
+
+    //  a read only connection can't change the journal mode
+    opts.journal_mode.clear();
+
+    reader_count = std::max<size_t>(reader_count, 1);
+    readers.reserve(reader_count);
+    idle_readers.reserve(reader_count);
+    for (size_t i = 0; i < reader_count; ++i) {
+        readers.push_back(std::make_unique<DBHelper>(db_path, SQLite::OPEN_READONLY | SQLite::OPEN_NOMUTEX));
+        readers.back()->configure(opts);
+        idle_readers.push_back(readers.back().get());
+    }
+}
+
+DBHelperPool::Lease DBHelperPool::reader() {
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [this] { return !idle_readers.empty(); });
+    DBHelper *db_helper = idle_readers.back();
+    idle_readers.pop_back();
+    return {this, db_helper, false};
+}
+
+DBHelperPool::Lease DBHelperPool::writer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [this] { return !writer_busy; });
+    writer_busy = true;
+    return {this, writer_helper.get(), true};
+}
+
+bool DBHelperPool::table_exists(const std::string &table_name) {
+    Lease lease = reader();
+    return lease->table_exists(table_name);
+}
+
+bool DBHelperPool::table_empty(const std::string &table_name) {
+    Lease lease = reader();
+    return lease->table_empty(table_name);
+}
+
+long long DBHelperPool::row_count(const std::string &table_name, DBHelper::count_mode mode) {
+    Lease lease = reader();
+    return lease->row_count(table_name, mode);
+}
+
+bool DBHelperPool::track_row_count(const std::string &table_name) {
+    Lease lease = writer();
+    return lease->track_row_count(table_name);
+}
+
+bool DBHelperPool::untrack_row_count(const std::string &table_name) {
+    Lease lease = writer();
+    return lease->untrack_row_count(table_name);
+}
+
+std::string DBHelperPool::drop(const std::string &table_name) {
+    Lease lease = writer();
+    return lease->drop(table_name);
+}
+
+DBHelperPool::Lease::Lease(DBHelperPool *pool, DBHelper *db_helper, bool writer)
+        : pool(pool), db_helper(db_helper), writer(writer) {}
+
+DBHelperPool::Lease::Lease(Lease &&other) noexcept
+        : pool(other.pool), db_helper(other.db_helper), writer(other.writer) {
+    other.pool = nullptr;
+}
+
+DBHelperPool::Lease &DBHelperPool::Lease::operator=(Lease &&other) noexcept {
+    if (this != &other) {
+        give_back();
+        pool = other.pool;
+        db_helper = other.db_helper;
+        writer = other.writer;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+DBHelperPool::Lease::~Lease() { give_back(); }
+
+void DBHelperPool::Lease::give_back() {
+    if (pool == nullptr)
+        return;
+
+    //  a statement left mid-step keeps its WAL snapshot, the next lease would read the database as it was then
+    //  and checkpoints couldn't get past it
+    sqlite3 *handle = db_helper->db().getHandle();
+    for (sqlite3_stmt *statement = sqlite3_next_stmt(handle, nullptr); statement;
+         statement = sqlite3_next_stmt(handle, statement))
+        if (sqlite3_stmt_busy(statement))
+            sqlite3_reset(statement);
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (writer)
+            pool->writer_busy = false;
+        else
+            pool->idle_readers.push_back(db_helper);
+    }
+    //  readers and the writer wait on the same condition
+    pool->released.notify_all();
+    pool = nullptr;
+}
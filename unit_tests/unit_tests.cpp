@@ -5,10 +5,23 @@
 //
 
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <cstdio>
 #include "doctest.h"
 
 #define DBHELPER_TESTING_MODE
 #include "../include/DBHelper.h"
+#include "../include/DBHelperPool.h"
+#include "../include/AsyncWriter.h"
+
+struct RowTest {
+    int id;
+    std::string name;
+    std::optional<double> score;
+    std::vector<char> data;
+};
+DBHELPER_ROW(RowTest, id, name, score, data)
 
 //  PUBLIC FUNCTIONS TESTS
 TEST_CASE("constructors") {
@@ -95,6 +108,35 @@ TEST_CASE(R"(sqlite statements construction)") {
         CHECK_EQ(db_helper.as_questionmark(i), "?");
     }
 
+    SUBCASE(R"(question_marks<N>::view())") {
+        CHECK_EQ(DBHelper::question_marks<0>::view(), "");
+        CHECK_EQ(DBHelper::question_marks<1>::view(), "?");
+        CHECK_EQ(DBHelper::question_marks<3>::view(), "?, ?, ?");
+    }
+
+    SUBCASE(R"(insert_sql(const std::string &table_name, const Args &...args))") {
+        std::string id = "id", val = "val";
+        const std::string &sql = db_helper.insert_sql("test2", id, val, 1, "a");
+        CHECK_EQ(sql, "INSERT INTO test2 (id, val) VALUES (?, ?)");
+        CHECK_EQ(&db_helper.insert_sql("test2", id, val, 2, "b"), &sql);
+        CHECK_EQ(db_helper.insert_sql("test3", id, val, 1, "a"), "INSERT INTO test3 (id, val) VALUES (?, ?)");
+        CHECK_EQ(db_helper.insert_sql("test3", val, id, 1, "a"), "INSERT INTO test3 (val, id) VALUES (?, ?)");
+        //  alternating between tables keeps every one of them cached
+        CHECK_EQ(sql, "INSERT INTO test2 (id, val) VALUES (?, ?)");
+        CHECK_EQ(&db_helper.insert_sql("test2", id, val, 3, "c"), &sql);
+    }
+
+    SUBCASE(R"(update_sql(const std::string &table_name, integer_pack<size_t, indexes...> columns, const Args &args, const Where &...where))") {
+        typename integer_range_generate<std::size_t, 0, 2, 2>::type columns;
+        std::string id = "id", op = "=";
+        const std::string &sql = db_helper.update_sql("test2", columns, std::make_tuple("val", 1, "id", 2), id, op);
+        CHECK_EQ(sql, "UPDATE test2 SET val=?, id=? WHERE id=?");
+        CHECK_EQ(&db_helper.update_sql("test2", columns, std::make_tuple("val", 3, "id", 4), id, op), &sql);
+        op = ">";
+        CHECK_EQ(db_helper.update_sql("test2", columns, std::make_tuple("val", 3, "id", 4), id, op),
+                 "UPDATE test2 SET val=?, id=? WHERE id>?");
+    }
+
     SUBCASE(R"(col_name_eq_question_mark(std::string const &str))") {
         std::string var = "default";
         const std::string const_var = "const";
@@ -482,6 +524,1499 @@ TEST_CASE("delete") {
     }
 }
 
+TEST_CASE("statement cache") {
+    DBHelper db_helper;
+    db_helper.drop("cache_test");
+    db_helper.create("cache_test", "id", DBHelper::INTEGER, "val", DBHelper::TEXT);
+
+    SUBCASE(R"(prepare(const std::string &sql))") {
+        for (int i = 0; i < 3; ++i)
+            CHECK_EQ(db_helper.insert("cache_test", "id", "val", i, "a"), "INSERT INTO cache_test (id, val) VALUES (?, ?)");
+
+        CHECK_EQ(db_helper.get_statement_cache_stats().misses, 1);
+        CHECK_EQ(db_helper.get_statement_cache_stats().hits, 2);
+        CHECK_EQ(db_helper.get_statement_cache_size(), 1);
+
+        auto query = db_helper.select("cache_test");
+        auto query2 = db_helper.select("cache_test");
+        CHECK_NE(query.get(), query2.get());
+        query->executeStep();
+        CHECK_EQ(query->getColumn("id").getInt(), 0);
+    }
+
+    SUBCASE(R"(set_statement_cache_capacity(size_t capacity))") {
+        db_helper.set_statement_cache_capacity(1);
+        db_helper.insert("cache_test", "id", "val", 1, "a");
+        db_helper.try_get<std::string>("cache_test", "val", "id", 1);
+        db_helper.try_get<int>("cache_test", "id", "val", "a");
+        CHECK_EQ(db_helper.get_statement_cache_size(), 1);
+        CHECK_EQ(db_helper.get_statement_cache_stats().evictions, 2);
+
+        db_helper.set_statement_cache_capacity(0);
+        CHECK_EQ(db_helper.get_statement_cache_size(), 0);
+    }
+
+    SUBCASE("get leaves no statement holding a lock") {
+        db_helper.insert("cache_test", "id", "val", 1, "a");
+        CHECK_EQ(db_helper.get("cache_test", "val", "id", 1).getString(), "a");
+
+        DBHelper other(db_helper.get_db_full_path(), SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        CHECK_FALSE(other.update("cache_test", "id", 1, "val", "b").empty());
+        CHECK_EQ(db_helper.get("cache_test", "val", "id", 1).getString(), "b");
+    }
+
+    SUBCASE("a select dropped mid-step leaves no statement holding a lock") {
+        db_helper.insert("cache_test", "id", "val", 1, "a");
+        db_helper.insert("cache_test", "id", "val", 2, "b");
+        {
+            std::shared_ptr<SQLite::Statement> query = db_helper.select("cache_test");
+            REQUIRE(query->executeStep());
+        }
+
+        DBHelper other(db_helper.get_db_full_path(), SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        CHECK_FALSE(other.update("cache_test", "id", 1, "val", "c").empty());
+        CHECK_EQ(db_helper.try_get<std::string>("cache_test", "val", "id", 1), "c");
+
+        {
+            DBHelper::Cursor cursor = db_helper.scan("cache_test", std::make_tuple("id", ">", 0));
+            REQUIRE(cursor.begin() != cursor.end());
+        }
+        CHECK_FALSE(other.update("cache_test", "id", 2, "val", "d").empty());
+        CHECK_EQ(db_helper.try_get<std::string>("cache_test", "val", "id", 2), "d");
+    }
+}
+
+TEST_CASE("transactions") {
+    DBHelper db_helper;
+    db_helper.drop("transaction_test");
+    db_helper.create("transaction_test", "id", DBHelper::INTEGER);
+
+    SUBCASE(R"(begin(transaction_type behavior), commit(), rollback())") {
+        CHECK_EQ(db_helper.begin(DBHelper::IMMEDIATE), true);
+        CHECK_EQ(db_helper.in_transaction(), true);
+        db_helper.insert("transaction_test", "id", 1);
+        CHECK_EQ(db_helper.rollback(), true);
+        CHECK_EQ(db_helper.in_transaction(), false);
+        CHECK_EQ(db_helper.table_empty("transaction_test"), true);
+
+        CHECK_EQ(db_helper.begin(), true);
+        db_helper.insert("transaction_test", "id", 1);
+        CHECK_EQ(db_helper.commit(), true);
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 1), true);
+    }
+
+    SUBCASE(R"(Transaction(DBHelper &db_helper, transaction_type behavior))") {
+        {
+            DBHelper::Transaction transaction(db_helper);
+            db_helper.insert("transaction_test", "id", 1);
+        }
+        CHECK_EQ(db_helper.table_empty("transaction_test"), true);
+
+        DBHelper::Transaction transaction(db_helper, DBHelper::EXCLUSIVE);
+        db_helper.insert("transaction_test", "id", 1);
+        CHECK_EQ(transaction.commit(), true);
+        CHECK_EQ(transaction.is_active(), false);
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 1), true);
+    }
+
+    SUBCASE(R"(Savepoint(DBHelper &db_helper))") {
+        DBHelper::Transaction transaction(db_helper);
+        db_helper.insert("transaction_test", "id", 1);
+        {
+            DBHelper::Savepoint savepoint(db_helper);
+            db_helper.insert("transaction_test", "id", 2);
+            {
+                DBHelper::Savepoint nested(db_helper);
+                db_helper.insert("transaction_test", "id", 3);
+                CHECK_EQ(nested.release(), true);
+            }
+        }
+        {
+            DBHelper::Savepoint savepoint(db_helper);
+            db_helper.insert("transaction_test", "id", 4);
+            CHECK_EQ(savepoint.release(), true);
+        }
+        CHECK_EQ(transaction.commit(), true);
+
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 1), true);
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 2), false);
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 3), false);
+        CHECK_EQ(db_helper.exists("transaction_test", "id", 4), true);
+
+        //  releasing the outermost savepoint commits, a deferred foreign key violation fails it
+        db_helper.execute("PRAGMA foreign_keys=ON")->exec();
+        db_helper.execute("CREATE TABLE IF NOT EXISTS transaction_child (id INTEGER PRIMARY KEY, parent INTEGER "
+                          "REFERENCES transaction_child(id) DEFERRABLE INITIALLY DEFERRED)")->exec();
+        {
+            DBHelper::Savepoint savepoint(db_helper);
+            db_helper.insert("transaction_child", "id", "parent", 1, 100);
+            CHECK_EQ(savepoint.release(), false);
+            CHECK_EQ(savepoint.is_active(), true);
+            CHECK_EQ(savepoint.rollback(), true);
+        }
+        CHECK_EQ(db_helper.in_transaction(), false);
+        CHECK_EQ(db_helper.table_empty("transaction_child"), true);
+        db_helper.execute("PRAGMA foreign_keys=OFF")->exec();
+        db_helper.drop("transaction_child");
+    }
+}
+
+TEST_CASE("insert_many") {
+    DBHelper db_helper;
+    db_helper.drop("insert_many_test");
+    db_helper.create("insert_many_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "val", DBHelper::TEXT);
+
+    SUBCASE(R"(insert_many(const std::string &table_name, const std::vector<std::string> &columns, const Rows &rows))") {
+        std::vector<std::tuple<int, std::string>> rows;
+        for (int i = 0; i < 1234; ++i)
+            rows.emplace_back(i, std::to_string(i));
+
+        CHECK_EQ(db_helper.insert_many("insert_many_test", {"id", "val"}, rows), 1234);
+        CHECK_EQ(db_helper.db().execAndGet("SELECT COUNT(*) FROM insert_many_test").getInt(), 1234);
+        CHECK_EQ(db_helper.get("insert_many_test", "val", "id", 1233).getString(), "1233");
+
+        std::vector<std::pair<int, std::string>> pairs = {{2000, "a"}, {2001, "b"}};
+        CHECK_EQ(db_helper.insert_many("insert_many_test", {"id", "val"}, pairs), 2);
+        CHECK_EQ(db_helper.insert_many("insert_many_test", {"id"}, pairs), 0);
+    }
+
+    SUBCASE(R"(insert_many(...) rolls back on failure)") {
+        std::vector<std::tuple<int, std::string>> rows;
+        for (int i = 0; i < 600; ++i)
+            rows.emplace_back(i % 550, "a");
+
+        CHECK_EQ(db_helper.insert_many("insert_many_test", {"id", "val"}, rows), 0);
+        CHECK_EQ(db_helper.table_empty("insert_many_test"), true);
+    }
+
+    SUBCASE(R"(insert_many(...) fails when its savepoint can't be released)") {
+        //  every statement goes through, the deferred foreign key check fails the commit on release
+        db_helper.execute("PRAGMA foreign_keys=ON")->exec();
+        db_helper.execute("CREATE TABLE insert_many_child (id INTEGER PRIMARY KEY, parent INTEGER "
+                          "REFERENCES insert_many_child(id) DEFERRABLE INITIALLY DEFERRED)")->exec();
+        std::vector<std::tuple<int, int>> rows = {{1, 1}, {2, 100}};
+
+        CHECK_EQ(db_helper.insert_many("insert_many_child", {"id", "parent"}, rows), 0);
+        CHECK_EQ(db_helper.in_transaction(), false);
+        CHECK_EQ(db_helper.table_empty("insert_many_child"), true);
+        db_helper.execute("PRAGMA foreign_keys=OFF")->exec();
+        db_helper.drop("insert_many_child");
+    }
+}
+
+TEST_CASE("DBHelperPool") {
+    std::string db_path = DBHelper().get_db_dir_path() + "pool.db3";
+    DBHelperPool pool(db_path, 4);
+    pool.drop("pool_test");
+    pool.create("pool_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "val", DBHelper::TEXT);
+
+    SUBCASE(R"(DBHelperPool(const std::string &db_path, size_t reader_count))") {
+        CHECK_EQ(pool.get_reader_count(), 4);
+        CHECK_EQ(pool.reader()->db().execAndGet("PRAGMA journal_mode").getString(), "wal");
+        CHECK_EQ(pool.table_exists("pool_test"), true);
+        CHECK_EQ(pool.table_empty("pool_test"), true);
+    }
+
+    SUBCASE(R"(routing)") {
+        CHECK_EQ(pool.insert("pool_test", "id", "val", 1, "a"), "INSERT INTO pool_test (id, val) VALUES (?, ?)");
+        CHECK_EQ(pool.insert("pool_test", {"id", "val"}, 2, "b"), "INSERT INTO pool_test (id, val) VALUES (?, ?)");
+        CHECK_EQ(pool.update("pool_test", "id", 2, "val", "c"), "UPDATE pool_test SET val=? WHERE id=?");
+        CHECK_EQ(pool.exists("pool_test", "id", 2), true);
+        CHECK_EQ(pool.get("pool_test", "val", "id", 2)->getString(), "c");
+
+        auto query = pool.select("pool_test", {"id"}, std::make_tuple("id", "=", 1));
+        CHECK_EQ(query->getQuery(), "SELECT id FROM pool_test WHERE id=?");
+        query->executeStep();
+        CHECK_EQ(query->getColumn(0).getInt(), 1);
+
+        CHECK_EQ(pool.dele("pool_test", "id", 1), "DELETE FROM pool_test WHERE id=?");
+        CHECK_EQ(pool.exists("pool_test", "id", 1), false);
+    }
+
+    SUBCASE(R"(concurrent readers)") {
+        std::vector<std::tuple<int, std::string>> rows;
+        for (int i = 0; i < 100; ++i)
+            rows.emplace_back(i, std::to_string(i));
+        CHECK_EQ(pool.insert_many("pool_test", {"id", "val"}, rows), 100);
+
+        std::atomic<int> found = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t)
+            threads.emplace_back([&pool, &found] {
+                for (int i = 0; i < 100; ++i)
+                    if (pool.exists("pool_test", "id", i))
+                        ++found;
+            });
+        for (auto &thread: threads)
+            thread.join();
+
+        CHECK_EQ(found, 800);
+    }
+
+    SUBCASE("a reader goes back to the pool without its read snapshot") {
+        DBHelperPool single(db_path, 1);
+        single.insert("pool_test", "id", "val", 1, "a");
+        single.insert("pool_test", "id", "val", 2, "b");
+        {
+            auto query = single.select("pool_test");
+            REQUIRE(query->executeStep());
+        }
+        single.insert("pool_test", "id", "val", 3, "c");
+        CHECK_EQ(single.exists("pool_test", "id", 3), true);
+
+        //  a statement outliving its lease is reset when the reader is given back
+        std::shared_ptr<SQLite::Statement> kept;
+        {
+            DBHelperPool::Lease lease = single.reader();
+            kept = lease->execute("SELECT * FROM pool_test");
+            REQUIRE(kept->executeStep());
+        }
+        single.insert("pool_test", "id", "val", 4, "d");
+        CHECK_EQ(single.exists("pool_test", "id", 4), true);
+    }
+}
+
+TEST_CASE("options") {
+    std::string db_path = DBHelper().get_db_dir_path() + "options.db3";
+
+    SUBCASE(R"(DBHelper(const std::string &db_path, const options &opts))") {
+        DBHelper db_helper(db_path, DBHelper::options::of(DBHelper::BULK_LOAD));
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA journal_mode").getString(), "wal");
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA synchronous").getInt(), 0);
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA cache_size").getInt(), -256000);
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA temp_store").getInt(), 2);
+    }
+
+    SUBCASE(R"(set_profile(profile p))") {
+        DBHelper db_helper(db_path, DBHelper::options::of(DBHelper::BALANCED));
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA synchronous").getInt(), 1);
+        CHECK_EQ(db_helper.set_profile(DBHelper::DURABLE), true);
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA synchronous").getInt(), 2);
+        CHECK_EQ(db_helper.set_profile(DBHelper::READ_MOSTLY), true);
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA cache_size").getInt(), -64000);
+    }
+
+    SUBCASE(R"(configure(const options &opts))") {
+        DBHelper db_helper(db_path);
+        DBHelper::options opts;
+        opts.synchronous = "EXTRA";
+        CHECK_EQ(db_helper.configure(opts), true);
+        CHECK_EQ(db_helper.db().execAndGet("PRAGMA synchronous").getInt(), 3);
+
+        opts.journal_mode = "DELETE";
+        db_helper.begin();
+        CHECK_EQ(db_helper.configure(opts), false);
+        db_helper.rollback();
+
+        //  sqlite keeps the memory journal and says so instead of failing
+        DBHelper in_memory(":memory:");
+        CHECK_EQ(in_memory.configure(DBHelper::options::of(DBHelper::BALANCED)), false);
+        CHECK_EQ(in_memory.db().execAndGet("PRAGMA journal_mode").getString(), "memory");
+        opts.journal_mode = "memory";
+        CHECK_EQ(in_memory.configure(opts), true);
+    }
+}
+
+TEST_CASE("scan") {
+    DBHelper db_helper;
+    db_helper.drop("scan_test");
+    db_helper.create("scan_test", "id", DBHelper::INTEGER, "val", DBHelper::TEXT, "data", DBHelper::BLOB);
+    std::vector<std::tuple<int, std::string>> rows = {{1, "a"}, {2, "bb"}, {3, "ccc"}};
+    db_helper.insert_many("scan_test", {"id", "val"}, rows);
+
+    SUBCASE(R"(scan(const std::string &table_name, Args &&...args))") {
+        int count = 0;
+        for (auto row: db_helper.scan("scan_test")) {
+            ++count;
+            CHECK_EQ(row.column_count(), 3);
+            CHECK_EQ(row.get_int(0), count);
+            CHECK_EQ(row.get_text(1).size(), count);
+            CHECK_EQ(row.is_null(2), true);
+        }
+        CHECK_EQ(count, 3);
+
+        std::string ids;
+        for (auto row: db_helper.scan("scan_test", std::make_tuple("id", ">", 1), "val"))
+            ids += row.get_text(0);
+        CHECK_EQ(ids, "bbccc");
+    }
+
+    SUBCASE(R"(scan(const std::string &table_name, std::initializer_list<std::string> columns, Args &&...args))") {
+        DBHelper::Cursor cursor = db_helper.scan("scan_test", {"val"}, std::make_tuple("id", "=", 2));
+        CHECK_EQ(cursor.statement().getQuery(), "SELECT val FROM scan_test WHERE id=?");
+        auto it = cursor.begin();
+        CHECK_NE(it, cursor.end());
+        CHECK_EQ((*it).get_text(0), "bb");
+        ++it;
+        CHECK_EQ(it, cursor.end());
+
+        DBHelper::Cursor moved = std::move(cursor);
+        CHECK_EQ(static_cast<bool>(cursor), false);
+        CHECK_EQ(static_cast<bool>(moved), true);
+    }
+}
+
+TEST_CASE("DBHELPER_ROW") {
+    DBHelper db_helper;
+    db_helper.drop("row_test");
+    db_helper.create("row_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                     "score", "data", DBHelper::BLOB);
+
+    SUBCASE(R"(DBRow<RowTest>)") {
+        CHECK_EQ(std::string(DBRow<RowTest>::columns), "id, name, score, data");
+        CHECK_EQ(db_helper.row_size<RowTest>(), 4);
+        CHECK_EQ(db_helper.row_question_mark_equation_comma<RowTest>(), "id=?, name=?, score=?, data=?");
+    }
+
+    SUBCASE(R"(insert(const std::string &table_name, const Row &row))") {
+        CHECK_EQ(db_helper.insert("row_test", RowTest{1, "a", 0.5, {'x', '\0', 'y'}}),
+                 "INSERT INTO row_test (id, name, score, data) VALUES (?, ?, ?, ?)");
+        CHECK_EQ(db_helper.insert("row_test", RowTest{2, "b", std::nullopt, {}}),
+                 "INSERT INTO row_test (id, name, score, data) VALUES (?, ?, ?, ?)");
+
+        std::vector<RowTest> rows = db_helper.select<RowTest>("row_test");
+        REQUIRE_EQ(rows.size(), 2);
+        CHECK_EQ(rows[0].name, "a");
+        CHECK_EQ(rows[0].score.value(), 0.5);
+        CHECK_EQ(rows[0].data, std::vector<char>{'x', '\0', 'y'});
+        CHECK_EQ(rows[1].score.has_value(), false);
+    }
+
+    SUBCASE(R"(select<Row>(const std::string &table_name, const std::tuple<Col, Op, Val> &condition))") {
+        std::vector<RowTest> rows = {{1, "a", 1, {}}, {2, "b", 2, {}}, {3, "c", 3, {}}};
+        CHECK_EQ(db_helper.insert_many("row_test", rows), 3);
+
+        std::vector<RowTest> result = db_helper.select<RowTest>("row_test", std::make_tuple("id", ">", 1));
+        REQUIRE_EQ(result.size(), 2);
+        CHECK_EQ(result[0].name, "b");
+
+        std::vector<std::tuple<std::string, std::string, int>> conditions;
+        conditions.emplace_back("id", ">", 1);
+        conditions.emplace_back("id", "<", 3);
+        result = db_helper.select<RowTest>("row_test", conditions);
+        REQUIRE_EQ(result.size(), 1);
+        CHECK_EQ(result[0].id, 2);
+
+        for (auto row: db_helper.scan("row_test", std::make_tuple("id", "=", 3), "id", "name", "score", "data")) {
+            CHECK_EQ(row.as<RowTest>().name, "c");
+            CHECK_EQ(row.get<std::optional<int>>(2), 3);
+        }
+
+        //  members are matched by name, not by where the query put them
+        for (auto row: db_helper.scan("row_test", {"data", "score", "name", "id"}, std::make_tuple("id", "=", 2))) {
+            RowTest decoded = row.as<RowTest>();
+            CHECK_EQ(decoded.id, 2);
+            CHECK_EQ(decoded.name, "b");
+            CHECK_EQ(decoded.score, 2);
+        }
+    }
+
+    SUBCASE(R"(update(const std::string &table_name, const std::tuple<Col, Op, Val> &condition, const Row &row))") {
+        db_helper.insert("row_test", RowTest{1, "a", 1, {}});
+        CHECK_EQ(db_helper.update("row_test", std::make_tuple("id", "=", 1), RowTest{1, "z", std::nullopt, {}}),
+                 "UPDATE row_test SET id=?, name=?, score=?, data=? WHERE id=?");
+        CHECK_EQ(db_helper.select<RowTest>("row_test")[0].name, "z");
+    }
+}
+
+TEST_CASE("indexes") {
+    DBHelper db_helper;
+    db_helper.drop("index_test");
+    db_helper.create("index_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "user_id", DBHelper::INTEGER,
+                     "created", DBHelper::INTEGER, "closed", DBHelper::INTEGER);
+
+    SUBCASE(R"(create_index(...), drop_index(const std::string &index_name))") {
+        CHECK_EQ(db_helper.create_index("index_test_user", "index_test", {"user_id"}, {"created"}),
+                 "CREATE INDEX IF NOT EXISTS index_test_user ON index_test (user_id, created)");
+        CHECK_EQ(db_helper.create_index("index_test_open", "index_test", {"user_id"}, {}, "closed = 0", true),
+                 "CREATE UNIQUE INDEX IF NOT EXISTS index_test_open ON index_test (user_id) WHERE closed = 0");
+        CHECK_EQ(db_helper.create_index("index_test_none", "index_test", {}), "");
+        CHECK_EQ(db_helper.drop_index("index_test_user"), "DROP INDEX IF EXISTS index_test_user");
+        CHECK_EQ(db_helper.drop_index("index_test_open"), "DROP INDEX IF EXISTS index_test_open");
+    }
+
+    SUBCASE(R"(advise_index(const std::string &sql, bool auto_create))") {
+        CHECK_EQ(db_helper.advise_index("SELECT * FROM index_test").has_value(), false);
+        CHECK_EQ(db_helper.advise_index("SELECT * FROM index_test WHERE id=?").has_value(), false);
+
+        auto advice = db_helper.advise_index("SELECT id FROM index_test WHERE created>? AND user_id=?");
+        REQUIRE(advice.has_value());
+        CHECK_EQ(advice->table_name, "index_test");
+        CHECK_EQ(advice->columns, std::vector<std::string>{"user_id", "created"});
+        CHECK_EQ(advice->create_sql,
+                 "CREATE INDEX IF NOT EXISTS dbhelper_idx_index_test_user_id_created ON index_test (user_id, created)");
+    }
+
+    SUBCASE(R"(advise_indexes(bool auto_create))") {
+        db_helper.insert("index_test", "user_id", "created", "closed", 1, 1, 0);
+        db_helper.try_get<int>("index_test", "id", "user_id", 1);
+        db_helper.dele("index_test", "closed", 1);
+
+        std::vector<DBHelper::index_advice> advice = db_helper.advise_indexes(true);
+        CHECK_EQ(advice.size(), 2);
+        CHECK_EQ(db_helper.advise_indexes().size(), 0);
+        CHECK_EQ(db_helper.drop_index("dbhelper_idx_index_test_user_id"), "DROP INDEX IF EXISTS dbhelper_idx_index_test_user_id");
+        CHECK_EQ(db_helper.drop_index("dbhelper_idx_index_test_closed"), "DROP INDEX IF EXISTS dbhelper_idx_index_test_closed");
+    }
+}
+
+TEST_CASE("bloom filter") {
+    DBHelper db_helper;
+    db_helper.drop("bloom_test");
+    db_helper.create("bloom_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                     "data", DBHelper::BLOB);
+    db_helper.insert("bloom_test", "id", "name", 1, "one");
+    db_helper.insert("bloom_test", "id", "name", 2, "two");
+
+    SUBCASE("BloomFilter") {
+        BloomFilter filter(1000, 0.01);
+        for (int i = 0; i < 1000; ++i)
+            filter.add(std::to_string(i));
+        for (int i = 0; i < 1000; ++i)
+            CHECK(filter.might_contain(std::to_string(i)));
+
+        int false_positives = 0;
+        for (int i = 1000; i < 11000; ++i)
+            false_positives += filter.might_contain(std::to_string(i));
+        CHECK_LT(false_positives, 300);
+        CHECK_EQ(filter.size(), 1000);
+
+        filter.clear();
+        CHECK_EQ(filter.might_contain("1"), false);
+    }
+
+    SUBCASE(R"(exists(const std::string &table_name, const std::string &column, T value))") {
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "one"), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "one\" OR \"1\"=\"1"), false);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 2), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 3), false);
+    }
+
+    SUBCASE(R"(enable_bloom_filter(...))") {
+        CHECK_EQ(db_helper.enable_bloom_filter("bloom_test", "data"), false);
+        CHECK_EQ(db_helper.enable_bloom_filter("bloom_test", "missing"), false);
+        db_helper.drop("bloom_collation_test");
+        db_helper.db().exec("CREATE TABLE bloom_collation_test (name TEXT COLLATE NOCASE, code TEXT COLLATE BINARY)");
+        CHECK_EQ(db_helper.enable_bloom_filter("bloom_collation_test", "name"), false);
+        CHECK(db_helper.enable_bloom_filter("bloom_collation_test", "code"));
+        db_helper.disable_bloom_filter("bloom_collation_test", "code");
+        db_helper.drop("bloom_collation_test");
+        REQUIRE(db_helper.enable_bloom_filter("bloom_test", "id", 16));
+        REQUIRE(db_helper.enable_bloom_filter("bloom_test", "name", 16));
+
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 1), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 3), false);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", "2"), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "two"), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "three"), false);
+
+        db_helper.insert("bloom_test", "id", "name", 3, "three");
+        db_helper.insert("bloom_test", {"id", "name"}, 4, "four");
+        db_helper.update("bloom_test", "id", 1, "name", "uno");
+        db_helper.insert("bloom_test", "id", "name", "5", "five");
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 3), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 4), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "id", 5), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "three"), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "four"), true);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "uno"), true);
+
+        std::vector<std::tuple<int, std::string>> rows;
+        for (int i = 100; i < 200; ++i)
+            rows.emplace_back(i, "name" + std::to_string(i));
+        CHECK_EQ(db_helper.insert_many("bloom_test", {"id", "name"}, rows), 100);
+        for (int i = 100; i < 200; ++i)
+            CHECK_EQ(db_helper.exists("bloom_test", "name", "name" + std::to_string(i)), true);
+        CHECK_GE(db_helper.db_connection->bloom_filters.at("bloom_test.name").expected_values, 200);
+
+        db_helper.drop("bloom_test");
+        CHECK_EQ(db_helper.db_connection->bloom_filters.empty(), true);
+    }
+
+    SUBCASE("writes made past the DBHelper that enabled the filter") {
+        REQUIRE(db_helper.enable_bloom_filter("bloom_test", "name", 16));
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "three"), false);
+
+        db_helper.execute("INSERT INTO bloom_test (id, name) VALUES (3, 'three')")->exec();
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "three"), true);
+
+        DBHelper other(db_helper.get_db_full_path(), SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "four"), false);
+        other.insert("bloom_test", "id", "name", 4, "four");
+        CHECK_EQ(db_helper.exists("bloom_test", "name", "four"), true);
+
+        std::unique_ptr<DBHelper> first = DBHelper::shared(db_helper.get_db_full_path());
+        std::unique_ptr<DBHelper> second = DBHelper::shared(db_helper.get_db_full_path());
+        REQUIRE(first->enable_bloom_filter("bloom_test", "name", 16));
+        CHECK_EQ(second->exists("bloom_test", "name", "five"), false);
+        first->insert("bloom_test", "id", "name", 5, "five");
+        CHECK_EQ(second->exists("bloom_test", "name", "five"), true);
+    }
+}
+
+TEST_CASE("row_count") {
+    DBHelper db_helper;
+    db_helper.drop("count_test");
+    db_helper.create("count_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    CHECK_EQ(db_helper.table_empty("count_test"), true);
+    std::vector<std::tuple<int, std::string>> rows;
+    for (int i = 1; i <= 50; ++i)
+        rows.emplace_back(i, std::to_string(i));
+    db_helper.insert_many("count_test", {"id", "name"}, rows);
+    CHECK_EQ(db_helper.table_empty("count_test"), false);
+
+    SUBCASE(R"(row_count(const std::string &table_name, count_mode mode))") {
+        CHECK_EQ(db_helper.row_count("count_test"), 50);
+        CHECK_EQ(db_helper.row_count("count_test", DBHelper::ESTIMATE), 50);
+        CHECK_EQ(db_helper.row_count("missing_table"), -1);
+
+        db_helper.execute("ANALYZE count_test")->exec();
+        db_helper.insert("count_test", "id", "name", 51, "51");
+        CHECK_EQ(db_helper.row_count("count_test", DBHelper::ESTIMATE), 50);
+        CHECK_EQ(db_helper.row_count("count_test"), 51);
+    }
+
+    SUBCASE(R"(track_row_count(const std::string &table_name))") {
+        REQUIRE(db_helper.track_row_count("count_test"));
+        CHECK_EQ(db_helper.row_count("count_test"), 50);
+        db_helper.insert("count_test", "id", "name", 51, "51");
+        db_helper.dele("count_test", "id", "<", 11);
+        CHECK_EQ(db_helper.row_count("count_test"), 41);
+        CHECK_EQ(db_helper.row_count("count_test", DBHelper::ESTIMATE), 41);
+
+        CHECK(db_helper.untrack_row_count("count_test"));
+        db_helper.dele("count_test", "id", 51);
+        CHECK_EQ(db_helper.row_count("count_test"), 40);
+        CHECK_EQ(db_helper.track_row_count("missing_table"), false);
+    }
+}
+
+TEST_CASE("instrumentation") {
+    DBHelper db_helper;
+    db_helper.drop("stats_test");
+    db_helper.create("stats_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    db_helper.clear_statement_cache();
+    db_helper.enable_instrumentation();
+    REQUIRE(db_helper.is_instrumented());
+
+    SUBCASE(R"(get_query_stats())") {
+        for (int i = 0; i < 10; ++i)
+            db_helper.insert("stats_test", "id", "name", i, "name");
+        db_helper.update("stats_test", std::make_tuple("id", "<", 5), "name", "updated");
+        auto query = db_helper.select("stats_test");
+        while (query->executeStep());
+        query->reset();
+        query.reset();
+
+        const auto &stats = db_helper.get_query_stats();
+        const DBHelper::query_stats &insert = stats.at("INSERT INTO stats_test (id, name) VALUES (?, ?)");
+        CHECK_EQ(insert.calls, 10);
+        CHECK_EQ(insert.rows, 10);
+        CHECK_GT(insert.prepare_ns, 0);
+        CHECK_GT(insert.step_ns, 0);
+        size_t histogram_total = 0;
+        for (size_t count: insert.histogram)
+            histogram_total += count;
+        CHECK_EQ(histogram_total, 10);
+        CHECK_GT(insert.percentile_us(0.99), 0);
+
+        CHECK_EQ(stats.at("UPDATE stats_test SET name=? WHERE id<?").rows, 5);
+        CHECK_EQ(stats.at("SELECT * FROM stats_test").rows, 10);
+        CHECK_EQ(stats.at("SELECT * FROM stats_test").calls, 1);
+
+        std::string text = db_helper.dump_query_stats();
+        CHECK_EQ(text.rfind("calls\trows", 0), 0);
+        CHECK_NE(text.find("SELECT * FROM stats_test"), std::string::npos);
+        std::string json = db_helper.dump_query_stats(DBHelper::JSON);
+        CHECK_EQ(json.front(), '[');
+        CHECK_NE(json.find("{\"sql\": \"INSERT INTO stats_test (id, name) VALUES (?, ?)\", \"calls\": 10, \"rows\": 10"),
+                 std::string::npos);
+    }
+
+    SUBCASE(R"(enable_instrumentation(false))") {
+        db_helper.enable_instrumentation(false);
+        db_helper.reset_query_stats();
+        db_helper.insert("stats_test", "id", "name", 1, "name");
+        CHECK_EQ(db_helper.get_query_stats().empty(), true);
+        CHECK_EQ(db_helper.dump_query_stats(DBHelper::JSON), "[]\n");
+    }
+}
+
+TEST_CASE("slow query log") {
+    //  the destructor flushes into the sink, it has to outlive db_helper
+    std::vector<DBHelper::slow_query> logged;
+    DBHelper db_helper;
+    db_helper.drop("slow_test");
+    db_helper.create("slow_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    for (int i = 0; i < 20; ++i)
+        db_helper.insert("slow_test", "id", "name", i, std::to_string(i));
+
+    db_helper.set_slow_query_log(std::chrono::nanoseconds(0), [&logged](const DBHelper::slow_query &query) {
+        logged.push_back(query);
+    });
+
+    SUBCASE(R"(set_slow_query_log(std::chrono::nanoseconds threshold, slow_query_sink sink))") {
+        auto query = db_helper.select("slow_test", std::make_tuple("name", ">", "1"));
+        while (query->executeStep());
+        query->reset();
+        query.reset();
+        db_helper.flush_slow_queries();
+
+        REQUIRE_EQ(logged.size(), 1);
+        CHECK_EQ(logged[0].sql, "SELECT * FROM slow_test WHERE name>?");
+        CHECK_EQ(logged[0].expanded_sql, "SELECT * FROM slow_test WHERE name>'1'");
+        CHECK_EQ(logged[0].fullscan_steps, 19);
+        CHECK_GT(logged[0].vm_steps, 0);
+        CHECK_EQ(logged[0].plan.rfind("SCAN slow_test", 0), 0);
+
+        //  reported by the next call going through the statement cache
+        db_helper.exists("slow_test", "id", 5);
+        db_helper.table_empty("slow_test");
+        CHECK_EQ(logged.size(), 2);
+        CHECK_EQ(logged[1].expanded_sql, "SELECT EXISTS(SELECT 1 FROM slow_test WHERE id=5 LIMIT 1)");
+        CHECK_EQ(logged[1].fullscan_steps, 0);
+        CHECK_NE(logged[1].plan.find("SEARCH slow_test USING INTEGER PRIMARY KEY"), std::string::npos);
+    }
+
+    SUBCASE(R"(disable_slow_query_log())") {
+        db_helper.set_slow_query_log(std::chrono::hours(1), [&logged](const DBHelper::slow_query &query) {
+            logged.push_back(query);
+        });
+        db_helper.get("slow_test", "name", "id", 5);
+        db_helper.disable_slow_query_log();
+        db_helper.get("slow_test", "name", "id", 6);
+        db_helper.flush_slow_queries();
+        CHECK_EQ(logged.empty(), true);
+    }
+
+    SUBCASE("a throwing sink") {
+        int calls = 0;
+        db_helper.set_slow_query_log(std::chrono::nanoseconds(0), [&calls](const DBHelper::slow_query &) {
+            if (++calls == 1)
+                throw std::runtime_error("sink failed");
+        });
+        //  db() bypasses prepare(), both executions wait for the same flush
+        db_helper.db().exec("SELECT COUNT(*) FROM slow_test");
+        db_helper.db().exec("SELECT MAX(id) FROM slow_test");
+        CHECK_NOTHROW(db_helper.flush_slow_queries());
+        //  the query after the one the sink failed on is still reported
+        CHECK_EQ(calls, 2);
+        CHECK_NOTHROW(db_helper.table_empty("slow_test"));
+
+        db_helper.set_slow_query_log(std::chrono::nanoseconds(0), [&logged](const DBHelper::slow_query &query) {
+            logged.push_back(query);
+        });
+        db_helper.table_empty("slow_test");
+        db_helper.flush_slow_queries();
+        CHECK_EQ(logged.empty(), false);
+    }
+}
+
+TEST_CASE("AsyncWriter") {
+    const std::string path = DBHelper().get_db_dir_path() + "async.db3";
+    {
+        DBHelper db_helper(path);
+        db_helper.drop("async_test");
+        db_helper.create("async_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    }
+
+    SUBCASE(R"(insert/update/dele(...))") {
+        std::vector<std::future<bool>> written;
+        {
+            AsyncWriter writer(path, {64, std::chrono::milliseconds(5)});
+            std::vector<std::thread> threads;
+            std::mutex written_mutex;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&, t] {
+                    for (int i = 0; i < 250; ++i) {
+                        std::string name = "name" + std::to_string(i);
+                        std::future<bool> future = writer.insert("async_test", "id", "name", t * 1000 + i,
+                                                                 name.c_str());
+                        std::lock_guard<std::mutex> lock(written_mutex);
+                        written.push_back(std::move(future));
+                    }
+                });
+            }
+            for (std::thread &thread: threads)
+                thread.join();
+
+            CHECK(writer.flush().get());
+            CHECK(writer.update("async_test", std::make_tuple("id", "<", 100), "name", "updated").get());
+            CHECK(writer.dele("async_test", "id", 3249).get());
+            CHECK_EQ(writer.insert("async_test", "id", "name", 0, "duplicate").get(), false);
+            CHECK_THROWS_AS(writer.execute([](DBHelper &) -> bool { throw std::runtime_error("failed"); }).get(),
+                            std::runtime_error);
+
+            AsyncWriter::writer_stats stats = writer.get_stats();
+            CHECK_EQ(stats.writes, 1005);
+            CHECK_LT(stats.batches, 1005);
+            CHECK_EQ(stats.failed_commits, 0);
+        }
+
+        for (std::future<bool> &future: written)
+            CHECK(future.get());
+
+        DBHelper db_helper(path);
+        CHECK_EQ(db_helper.row_count("async_test"), 999);
+        CHECK_EQ(db_helper.get("async_test", "name", "id", 1002).getString(), "name2");
+        CHECK_EQ(db_helper.get("async_test", "name", "id", 99).getString(), "updated");
+    }
+
+    SUBCASE(R"(~AsyncWriter())") {
+        std::future<bool> last;
+        {
+            AsyncWriter writer(path, {8, std::chrono::seconds(10)});
+            for (int i = 0; i < 20; ++i)
+                last = writer.insert("async_test", "id", i);
+        }
+        CHECK(last.get());
+        CHECK_EQ(DBHelper(path).row_count("async_test"), 20);
+    }
+
+    SUBCASE("a batch rolled back by sqlite fails as a whole") {
+        AsyncWriter writer(path, {3, std::chrono::seconds(10)});
+        std::future<bool> first = writer.insert("async_test", "id", 5000);
+        //  stands in for SQLITE_FULL or SQLITE_IOERR, which end the transaction the same way
+        std::future<bool> failing = writer.execute([](DBHelper &db_helper) {
+            db_helper.execute("ROLLBACK")->exec();
+            return true;
+        });
+        std::future<bool> last = writer.insert("async_test", "id", 5001);
+
+        CHECK_EQ(first.get(), false);
+        CHECK_EQ(failing.get(), false);
+        CHECK_EQ(last.get(), false);
+        CHECK_EQ(writer.get_stats().failed_commits, 1);
+        CHECK_EQ(DBHelper(path).row_count("async_test"), 0);
+    }
+}
+
+struct PageTest {
+    int64_t id;
+    int64_t score;
+    std::string name;
+};
+
+DBHELPER_ROW(PageTest, id, score, name)
+
+TEST_CASE("pagination") {
+    DBHelper db_helper;
+    db_helper.drop("page_test");
+    db_helper.create("page_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "score", DBHelper::INTEGER,
+                     "name", DBHelper::TEXT);
+    db_helper.create_index("page_test_score", "page_test", {"score"});
+    std::vector<std::tuple<int, int, std::string>> rows;
+    for (int i = 1; i <= 25; ++i)
+        rows.emplace_back(i, i % 5, "name" + std::to_string(i));
+    db_helper.insert_many("page_test", {"id", "score", "name"}, rows);
+
+    SUBCASE(R"(select(const std::string &table_name, ..., const order_by &ordering))") {
+        auto query = db_helper.select("page_test", DBHelper::order_by{"id", DBHelper::DESC, 3, 1});
+        std::vector<int> ids;
+        while (query->executeStep())
+            ids.push_back(query->getColumn(0).getInt());
+        CHECK_EQ(ids, std::vector<int>{24, 23, 22});
+
+        query = db_helper.select("page_test", std::make_tuple("score", "=", 2), DBHelper::order_by{"id"});
+        ids.clear();
+        while (query->executeStep())
+            ids.push_back(query->getColumn(0).getInt());
+        CHECK_EQ(ids, std::vector<int>{2, 7, 12, 17, 22});
+
+        query = db_helper.select("page_test", std::vector<std::tuple<std::string, std::string, int>>{
+                {"score", ">", 0}, {"id", "<", 10}}, DBHelper::order_by{"name", DBHelper::ASC, 2});
+        ids.clear();
+        while (query->executeStep())
+            ids.push_back(query->getColumn(0).getInt());
+        CHECK_EQ(ids, std::vector<int>{1, 2});
+    }
+
+    SUBCASE(R"(select_page<Row>(...))") {
+        std::vector<int64_t> ids;
+        std::string token;
+        int pages = 0;
+        do {
+            DBHelper::page<PageTest> page = db_helper.select_page<PageTest>("page_test", "score", 10, token);
+            for (const PageTest &row: page.rows) {
+                if (!ids.empty())
+                    CHECK_LE(((ids.back() % 5) * 100 + ids.back()), row.score * 100 + row.id);
+                ids.push_back(row.id);
+            }
+            token = page.next_token;
+            ++pages;
+        } while (!token.empty());
+        CHECK_EQ(pages, 3);
+        CHECK_EQ(ids.size(), 25);
+        std::sort(ids.begin(), ids.end());
+        CHECK_EQ(std::unique(ids.begin(), ids.end()), ids.end());
+
+        DBHelper::page<PageTest> page = db_helper.select_page<PageTest>(
+                "page_test", "name", 2, {}, std::vector<std::tuple<std::string, std::string, int>>{
+                        {"score", "=", 1}}, DBHelper::DESC);
+        REQUIRE_EQ(page.rows.size(), 2);
+        CHECK_EQ(page.rows[0].name, "name6");
+        CHECK_EQ(page.rows[1].name, "name21");
+        page = db_helper.select_page<PageTest>(
+                "page_test", "name", 2, page.next_token, std::vector<std::tuple<std::string, std::string, int>>{
+                        {"score", "=", 1}}, DBHelper::DESC);
+        REQUIRE_EQ(page.rows.size(), 2);
+        CHECK_EQ(page.rows[0].name, "name16");
+        CHECK_EQ(page.rows[1].name, "name11");
+        page = db_helper.select_page<PageTest>(
+                "page_test", "name", 2, page.next_token, std::vector<std::tuple<std::string, std::string, int>>{
+                        {"score", "=", 1}}, DBHelper::DESC);
+        REQUIRE_EQ(page.rows.size(), 1);
+        CHECK_EQ(page.rows[0].name, "name1");
+        CHECK_EQ(page.next_token, "");
+
+        CHECK_EQ(db_helper.select_page<PageTest>("page_test", "score", 10, "garbage").rows.size(), 0);
+        CHECK_EQ(db_helper.select_page<PageTest>("page_test", "score", 10, "1:b0g").rows.size(), 0);
+
+        //  blob keys compare after every number and text, a token binding them as text would start over
+        db_helper.execute("UPDATE page_test SET name=CAST(name || x'00ff' AS BLOB)")->exec();
+        ids.clear();
+        pages = 0;
+        do {
+            DBHelper::page<PageTest> blob_page = db_helper.select_page<PageTest>("page_test", "name", 10, token);
+            for (const PageTest &row: blob_page.rows)
+                ids.push_back(row.id);
+            token = blob_page.next_token;
+        } while (++pages < 10 && !token.empty());
+        CHECK_EQ(pages, 3);
+        CHECK_EQ(ids.size(), 25);
+        std::sort(ids.begin(), ids.end());
+        CHECK_EQ(std::unique(ids.begin(), ids.end()), ids.end());
+
+        //  later pages seek through the index instead of scanning
+        auto plan = db_helper.execute(
+                "EXPLAIN QUERY PLAN SELECT rowid, score, id, score, name FROM page_test WHERE score IS NOT NULL AND "
+                "score>=? AND (score>? OR rowid>?) ORDER BY score ASC, rowid ASC LIMIT ?");
+        REQUIRE(plan->executeStep());
+        CHECK_EQ(plan->getColumn(3).getString(), "SEARCH page_test USING INDEX page_test_score (score>?)");
+    }
+}
+
+TEST_CASE(R"(get_many(...))") {
+    DBHelper db_helper;
+    db_helper.drop("get_many_test");
+    db_helper.create("get_many_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    std::vector<std::tuple<int64_t, std::string>> rows;
+    for (int64_t i = 0; i < 1200; ++i)
+        rows.emplace_back(i, "name" + std::to_string(i));
+    db_helper.insert_many("get_many_test", {"id", "name"}, rows);
+
+    std::vector<int64_t> keys;
+    for (int64_t i = 1300; i >= 0; i -= 2)
+        keys.push_back(i);
+
+    db_helper.clear_statement_cache();
+    std::unordered_map<int64_t, std::string> names = db_helper.get_many<std::string>("get_many_test", "name", "id", keys);
+    CHECK_EQ(names.size(), 600);
+    CHECK_EQ(names.at(0), "name0");
+    CHECK_EQ(names.at(1198), "name1198");
+    CHECK_EQ(names.count(1200), 0);
+    //  601 keys in chunks of 500, the second chunk reuses the first one's statement
+    CHECK_EQ(db_helper.get_statement_cache_size(), 1);
+
+    std::vector<std::optional<std::string>> aligned =
+            db_helper.get_many_aligned<std::string>("get_many_test", "name", "id", keys);
+    REQUIRE_EQ(aligned.size(), keys.size());
+    CHECK_EQ(aligned[0].has_value(), false);
+    CHECK_EQ(aligned[100].value(), "name1100");
+    CHECK_EQ(aligned.back().value(), "name0");
+
+    std::unordered_map<std::string, int64_t> ids = db_helper.get_many<int64_t>(
+            "get_many_test", "id", "name", std::vector<std::string>{"name5", "name7", "missing"});
+    CHECK_EQ(ids, std::unordered_map<std::string, int64_t>{{"name5", 5}, {"name7", 7}});
+    CHECK_EQ(db_helper.get_many<std::string>("get_many_test", "name", "id", std::vector<int>{}).empty(), true);
+
+    //  5 to 8 keys all go through the statement with 8 placeholders
+    db_helper.clear_statement_cache();
+    for (int64_t count = 5; count <= 8; ++count) {
+        std::vector<int64_t> some_keys(keys.end() - count, keys.end());
+        CHECK_EQ(db_helper.get_many<std::string>("get_many_test", "name", "id", some_keys).size(), count);
+    }
+    CHECK_EQ(db_helper.get_statement_cache_size(), 1);
+}
+
+TEST_CASE(R"(try_get<V>(...))") {
+    DBHelper db_helper;
+    db_helper.drop("try_get_test");
+    db_helper.create("try_get_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                     "score", DBHelper::INTEGER);
+    db_helper.insert("try_get_test", "id", "name", "score", 1, "one", 10);
+    db_helper.insert("try_get_test", "id", "name", 2, "two");
+
+    CHECK_EQ(db_helper.try_get<std::string>("try_get_test", "name", "id", 1), "one");
+    CHECK_EQ(db_helper.try_get<int64_t>("try_get_test", "score", "id", 1), 10);
+    CHECK_EQ(db_helper.try_get<int64_t>("try_get_test", "score", "id", 2), std::nullopt);
+    CHECK_EQ(db_helper.try_get<std::string>("try_get_test", "name", "id", 3), std::nullopt);
+    CHECK_EQ(db_helper.try_get<std::string>("try_get_test", "name", std::make_tuple("id", ">", 1)), "two");
+    CHECK_EQ(db_helper.try_get<std::string>("try_get_test", "name",
+                                            std::vector<std::tuple<std::string, std::string, int>>{
+                                                    {"id", ">=", 1}, {"score", "=", 10}}), "one");
+    CHECK_EQ(db_helper.try_get<std::string>("try_get_test", "missing_column", "id", 1), std::nullopt);
+
+    //  the statement is reset, dropping the table isn't blocked by it
+    db_helper.try_get<std::string>("try_get_test", "name", "id", 1);
+    CHECK_EQ(db_helper.drop("try_get_test"), "DROP TABLE IF EXISTS try_get_test");
+}
+
+TEST_CASE("result cache") {
+    DBHelper db_helper;
+    db_helper.drop("result_cache_test");
+    db_helper.drop("result_cache_other");
+    db_helper.create("result_cache_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    db_helper.create("result_cache_other", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY);
+    db_helper.insert("result_cache_test", "id", "name", 1, "one");
+    db_helper.insert("result_cache_other", "id", 1);
+    db_helper.enable_result_cache();
+
+    CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+    CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+    CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 2), std::nullopt);
+    CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 2), std::nullopt);
+    CHECK_EQ(db_helper.try_get<int64_t>("result_cache_other", "id", "id", 1), 1);
+    DBHelper::result_cache_stats stats = db_helper.get_result_cache_stats();
+    CHECK_EQ(stats.hits, 2);
+    CHECK_EQ(stats.misses, 3);
+    CHECK_EQ(stats.entries, 3);
+    CHECK_GT(stats.memory_usage, 0);
+    CHECK_EQ(stats.hit_ratio(), doctest::Approx(0.4));
+
+    SUBCASE("writes invalidate the results of their table") {
+        db_helper.update("result_cache_test", "id", 1, "name", "uno");
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "uno");
+        db_helper.execute("INSERT INTO result_cache_test (id, name) VALUES (2, 'two')")->exec();
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 2), "two");
+        CHECK_EQ(db_helper.get_result_cache_stats().invalidations, 2);
+
+        //  the other table's result is still served from the cache
+        CHECK_EQ(db_helper.try_get<int64_t>("result_cache_other", "id", "id", 1), 1);
+        CHECK_EQ(db_helper.get_result_cache_stats().hits, 3);
+    }
+
+    SUBCASE("typed select") {
+        db_helper.drop("page_test");
+        db_helper.create("page_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "score", DBHelper::INTEGER,
+                         "name", DBHelper::TEXT);
+        db_helper.insert("page_test", PageTest{1, 5, "a"});
+        CHECK_EQ(db_helper.select<PageTest>("page_test").size(), 1);
+        CHECK_EQ(db_helper.select<PageTest>("page_test").size(), 1);
+        db_helper.insert("page_test", PageTest{2, 6, "b"});
+        CHECK_EQ(db_helper.select<PageTest>("page_test").size(), 2);
+        db_helper.drop("page_test");
+    }
+
+    SUBCASE("commits of other connections clear the cache") {
+        db_helper.enable_result_cache(16 << 20, std::chrono::hours(1));
+        DBHelper other(db_helper.get_db_full_path(), SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        other.update("result_cache_test", "id", 1, "name", "eins");
+        //  within the staleness bound a hit doesn't look at the database
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+
+        db_helper.enable_result_cache(16 << 20, std::chrono::milliseconds(0));
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "eins");
+    }
+
+    SUBCASE("views and schema qualified names aren't cached") {
+        db_helper.execute("CREATE VIEW IF NOT EXISTS result_cache_view AS SELECT * FROM result_cache_test")->exec();
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_view", "name", "id", 1), "one");
+        CHECK_EQ(db_helper.try_get<std::string>("main.result_cache_test", "name", "id", 1), "one");
+        db_helper.update("result_cache_test", "id", 1, "name", "uno");
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_view", "name", "id", 1), "uno");
+        CHECK_EQ(db_helper.try_get<std::string>("main.result_cache_test", "name", "id", 1), "uno");
+        //  CREATE VIEW cleared the cache, nothing was stored since
+        CHECK_EQ(db_helper.get_result_cache_stats().entries, 0);
+        db_helper.execute("DROP VIEW result_cache_view")->exec();
+    }
+
+    SUBCASE("writes of DBHelpers sharing the connection clear the cache") {
+        std::unique_ptr<DBHelper> first = DBHelper::shared(db_helper.get_db_full_path());
+        std::unique_ptr<DBHelper> second = DBHelper::shared(db_helper.get_db_full_path());
+        first->enable_result_cache();
+        CHECK_EQ(first->try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+        second->update("result_cache_test", "id", 1, "name", "eins");
+        CHECK_EQ(first->try_get<std::string>("result_cache_test", "name", "id", 1), "eins");
+    }
+
+    SUBCASE("rolled back writes") {
+        {
+            DBHelper::Transaction transaction(db_helper);
+            db_helper.update("result_cache_test", "id", 1, "name", "uno");
+            CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "uno");
+        }
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+
+        {
+            DBHelper::Savepoint savepoint(db_helper);
+            db_helper.update("result_cache_test", "id", 1, "name", "uno");
+            CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "uno");
+        }
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+    }
+
+    SUBCASE("DELETE without WHERE and schema changes") {
+        db_helper.execute("DELETE FROM result_cache_test")->exec();
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), std::nullopt);
+
+        db_helper.drop("result_cache_test");
+        db_helper.create("result_cache_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+        db_helper.insert("result_cache_test", "id", "name", 2, "zwei");
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 2), "zwei");
+    }
+
+    SUBCASE("eviction") {
+        size_t capacity = stats.memory_usage;
+        db_helper.enable_result_cache(capacity);
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 3), std::nullopt);
+        CHECK_GT(db_helper.get_result_cache_stats().evictions, 0);
+        CHECK_LE(db_helper.get_result_cache_stats().memory_usage, capacity);
+
+        db_helper.disable_result_cache();
+        CHECK_FALSE(db_helper.is_result_cache_enabled());
+        CHECK_EQ(db_helper.get_result_cache_stats().entries, 0);
+        CHECK_EQ(db_helper.try_get<std::string>("result_cache_test", "name", "id", 1), "one");
+    }
+
+    db_helper.drop("result_cache_test");
+    db_helper.drop("result_cache_other");
+}
+
+TEST_CASE("export") {
+    DBHelper db_helper;
+    db_helper.drop("export_test");
+    db_helper.create("export_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT,
+                     "data", DBHelper::BLOB);
+    db_helper.execute("INSERT INTO export_test (id, name, data) VALUES (1, 'plain', X'01ab')")->exec();
+    db_helper.insert("export_test", "id", "name", 2, "with \"quotes\", commas\nand lines");
+    db_helper.insert("export_test", "id", 3);
+    //  stored as text by the column's affinity
+    db_helper.execute("INSERT INTO export_test (id, name) VALUES (4, 2.5)")->exec();
+
+    //  the export goes through the file descriptor, read it back from the start
+    auto exported = [&](auto &&export_to) {
+        std::FILE *file = std::tmpfile();
+        CHECK_EQ(export_to(fileno(file)), 4);
+        std::string content(static_cast<size_t>(std::ftell(file)), '\0');
+        std::rewind(file);
+        CHECK_EQ(std::fread(content.data(), 1, content.size(), file), content.size());
+        std::fclose(file);
+        return content;
+    };
+
+    SUBCASE("CSV") {
+        CHECK_EQ(exported([&](int fd) { return db_helper.export_table("export_test", fd, DBHelper::CSV); }),
+                 "id,name,data\n"
+                 "1,plain,01ab\n"
+                 "2,\"with \"\"quotes\"\", commas\nand lines\",\n"
+                 "3,,\n"
+                 "4,2.5,\n");
+    }
+
+    SUBCASE("JSON Lines") {
+        CHECK_EQ(exported([&](int fd) { return db_helper.export_table("export_test", fd, DBHelper::JSON_LINES); }),
+                 "{\"id\":1,\"name\":\"plain\",\"data\":\"01ab\"}\n"
+                 "{\"id\":2,\"name\":\"with \\\"quotes\\\", commas\\nand lines\",\"data\":null}\n"
+                 "{\"id\":3,\"name\":null,\"data\":null}\n"
+                 "{\"id\":4,\"name\":\"2.5\",\"data\":null}\n");
+    }
+
+    SUBCASE("binary") {
+        std::string content = exported([&](int fd) {
+            return db_helper.export_table("export_test", fd, DBHelper::BINARY);
+        });
+        std::string header("DBHX\x03\0\0\0\x02\0\0\0id\x04\0\0\0name\x04\0\0\0data", 30);
+        REQUIRE_GE(content.size(), header.size());
+        CHECK_EQ(content.substr(0, header.size()), header);
+        //  1, "plain", blob {0x01, 0xab}
+        CHECK_EQ(content.substr(header.size(), 26),
+                 std::string("\x01\x01\0\0\0\0\0\0\0\x03\x05\0\0\0plain\x04\x02\0\0\0\x01\xab", 26));
+    }
+
+    SUBCASE("select result") {
+        std::shared_ptr<SQLite::Statement> query = db_helper.select("export_test", "id");
+        CHECK_EQ(exported([&](int fd) { return db_helper.export_rows(*query, fd, DBHelper::CSV); }),
+                 "id\n1\n2\n3\n4\n");
+
+        //  empty text is quoted, an empty field stays NULL
+        query = db_helper.execute("SELECT id, '' AS empty, NULL AS missing FROM export_test");
+        CHECK_EQ(exported([&](int fd) { return db_helper.export_rows(*query, fd, DBHelper::CSV); }),
+                 "id,empty,missing\n1,\"\",\n2,\"\",\n3,\"\",\n4,\"\",\n");
+    }
+
+    CHECK_EQ(db_helper.export_table("missing_table", 1, DBHelper::CSV), -1);
+    CHECK_EQ(db_helper.export_table("export_test", -1, DBHelper::CSV), -1);
+    db_helper.drop("export_test");
+}
+
+TEST_CASE("import_file") {
+    DBHelper db_helper;
+    db_helper.drop("import_test");
+    db_helper.execute("CREATE TABLE import_test (id INTEGER PRIMARY KEY, name TEXT, score REAL)")->exec();
+    const std::string path = db_helper.get_db_dir_path() + "import_test.txt";
+    auto write = [&path](const std::string &content) { std::ofstream(path, std::ios::binary) << content; };
+
+    SUBCASE("CSV") {
+        write("score,id,name,unknown\n"
+              "1.5,1,plain,x\n"
+              "2,2,\"with \"\"quotes\"\", commas\nand lines\",x\r\n"
+              ",3,,x\n"
+              "\n"
+              "4,too,few\n"
+              "\"5\",5,\"007\",x");
+        DBHelper::import_stats stats = db_helper.import_file("import_test", path);
+        CHECK(stats.completed);
+        CHECK_EQ(stats.rows, 4);
+        CHECK_EQ(stats.rejected_rows, 1);
+        CHECK_GT(stats.bytes, 0);
+        CHECK_GT(stats.rows_per_second(), 0);
+
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 2), "with \"quotes\", commas\nand lines");
+        CHECK_EQ(db_helper.try_get<double>("import_test", "score", "id", 1), 1.5);
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "typeof(score)", "id", 2), "real");
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 3), std::nullopt);
+        CHECK_EQ(db_helper.try_get<double>("import_test", "score", "id", 3), std::nullopt);
+        //  text stays text in a TEXT column, quoted numbers still get a numeric column's affinity
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 5), "007");
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "typeof(score)", "id", 5), "real");
+    }
+
+    SUBCASE("CSV split into chunks") {
+        std::string content;
+        for (int i = 0; i < 1000; ++i)
+            content += std::to_string(i) + ",\"line\n" + std::to_string(i) + "\"," + std::to_string(i % 7) + "\n";
+        write(content);
+
+        DBHelper::import_options opts;
+        opts.header = false;
+        opts.threads = 4;
+        opts.chunk_bytes = 64;
+        opts.rows_per_transaction = 100;
+        DBHelper::import_stats stats = db_helper.import_file("import_test", path, opts);
+        CHECK(stats.completed);
+        CHECK_EQ(stats.rows, 1000);
+        CHECK_EQ(stats.rejected_rows, 0);
+        CHECK_EQ(stats.bytes, content.size());
+        CHECK_EQ(db_helper.row_count("import_test"), 1000);
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 999), "line\n999");
+        CHECK_FALSE(db_helper.in_transaction());
+    }
+
+    SUBCASE("CSV with a quote inside an unquoted field") {
+        //  throws off the quote parity every split after the first row is guessed from
+        std::string content = "1000,5\" wide,1\n";
+        for (int i = 0; i < 1000; ++i)
+            content += std::to_string(i) + ",\"line\n" + std::to_string(i) + "\"," + std::to_string(i % 7) + "\n";
+        write(content);
+
+        DBHelper::import_options opts;
+        opts.header = false;
+        opts.threads = 4;
+        opts.chunk_bytes = 64;
+        DBHelper::import_stats stats = db_helper.import_file("import_test", path, opts);
+        CHECK(stats.completed);
+        CHECK_EQ(stats.rows, 1001);
+        CHECK_EQ(stats.rejected_rows, 0);
+        CHECK_EQ(stats.bytes, content.size());
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 1000), "5\" wide");
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 999), "line\n999");
+    }
+
+    SUBCASE("JSON Lines") {
+        write("{\"id\": 1, \"name\": \"caf\\u00e9 \\\"one\\\"\", \"score\": 2.5, \"extra\": {\"a\": [1, 2]}}\n"
+              "{\"id\": 2, \"name\": null}\n"
+              "\n"
+              "{\"id\": 3, \"name\": \"unterminated}\n"
+              "{\"name\": [1, \"]\"], \"id\": 4, \"score\": true}\n");
+        DBHelper::import_options opts;
+        opts.format = DBHelper::JSON_LINES;
+        DBHelper::import_stats stats = db_helper.import_file("import_test", path, opts);
+        CHECK(stats.completed);
+        CHECK_EQ(stats.rows, 3);
+        CHECK_EQ(stats.rejected_rows, 1);
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 1), "caf\xc3\xa9 \"one\"");
+        CHECK_EQ(db_helper.try_get<double>("import_test", "score", "id", 1), 2.5);
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 2), std::nullopt);
+        CHECK_EQ(db_helper.try_get<std::string>("import_test", "name", "id", 4), "[1, \"]\"]");
+        CHECK_EQ(db_helper.try_get<double>("import_test", "score", "id", 4), 1.0);
+    }
+
+    SUBCASE("a failed insert rolls back") {
+        write("id,name\n1,a\n1,duplicate\n");
+        DBHelper::import_stats stats = db_helper.import_file("import_test", path);
+        CHECK_FALSE(stats.completed);
+        CHECK_EQ(stats.rows, 0);
+        CHECK(db_helper.table_empty("import_test"));
+        CHECK_FALSE(db_helper.in_transaction());
+    }
+
+    CHECK_FALSE(db_helper.import_file("import_test", path + ".missing").completed);
+    CHECK_FALSE(db_helper.import_file("missing_table", path).completed);
+    std::remove(path.c_str());
+    db_helper.drop("import_test");
+}
+
+TEST_CASE("shared connections") {
+    std::unique_ptr<DBHelper> db_helper = DBHelper::shared();
+    sqlite3 *handle = db_helper->db().getHandle();
+
+    SUBCASE("DBHelpers of one thread share the connection") {
+        CHECK_EQ(DBHelper::shared()->db().getHandle(), handle);
+        CHECK_EQ(DBHelper::shared(db_helper->get_db_full_path())->db().getHandle(), handle);
+    }
+
+    SUBCASE("the connection outlives the DBHelper that opened it") {
+        std::unique_ptr<DBHelper> first = DBHelper::shared(db_helper->get_db_full_path() + ".registry");
+        sqlite3 *opened = first->db().getHandle();
+        std::unique_ptr<DBHelper> second = DBHelper::shared(db_helper->get_db_full_path() + ".registry");
+        first.reset();
+        CHECK_EQ(second->db().getHandle(), opened);
+        second->execute("CREATE TABLE IF NOT EXISTS registry_test (id INTEGER)")->exec();
+        CHECK_FALSE(second->drop("registry_test").empty());
+        std::remove((db_helper->get_db_full_path() + ".registry").c_str());
+    }
+
+    SUBCASE("constructors, other threads and in memory databases get their own") {
+        DBHelper own;
+        CHECK_NE(own.db().getHandle(), handle);
+        CHECK_NE(DBHelper(db_helper->get_db_full_path()).db().getHandle(), handle);
+
+        sqlite3 *threaded = nullptr;
+        std::thread([&] { threaded = DBHelper::shared(db_helper->get_db_full_path())->db().getHandle(); }).join();
+        CHECK_NE(threaded, handle);
+
+        std::unique_ptr<DBHelper> memory = DBHelper::shared(":memory:");
+        CHECK_NE(DBHelper::shared(":memory:")->db().getHandle(), memory->db().getHandle());
+    }
+
+    SUBCASE("instrumentation covers the whole connection") {
+        std::unique_ptr<DBHelper> other = DBHelper::shared();
+        db_helper->enable_instrumentation();
+        other->execute("SELECT 1")->executeStep();
+        other->enable_instrumentation();
+        other->execute("SELECT 2")->executeStep();
+        CHECK_FALSE(db_helper->get_query_stats().empty());
+        CHECK_FALSE(other->get_query_stats().empty());
+        other->enable_instrumentation(false);
+        CHECK(db_helper->is_instrumented());
+        other->execute("SELECT 3")->executeStep();
+        CHECK_EQ(db_helper->get_query_stats().count("SELECT 3"), 1);
+        CHECK_EQ(other->get_query_stats().count("SELECT 3"), 0);
+    }
+}
+
+TEST_CASE("schema cache") {
+    DBHelper db_helper;
+    db_helper.drop("schema_test");
+    db_helper.execute("CREATE TABLE schema_test (a INTEGER NOT NULL, b VARCHAR(10) DEFAULT 'x', c REAL, "
+                      "PRIMARY KEY (b, a))")->exec();
+    db_helper.execute("CREATE UNIQUE INDEX schema_test_c ON schema_test (c, a)")->exec();
+
+    std::shared_ptr<const DBHelper::table_schema> schema = db_helper.get_schema("schema_test");
+    REQUIRE(schema);
+    REQUIRE_EQ(schema->columns.size(), 3);
+    CHECK_EQ(schema->columns[0].name, "a");
+    CHECK(schema->columns[0].not_null);
+    CHECK_EQ(schema->columns[1].declared_type, "VARCHAR(10)");
+    CHECK_EQ(schema->columns[1].default_value, "'x'");
+    CHECK_EQ(schema->primary_key, std::vector<std::string>{"b", "a"});
+    CHECK_EQ(db_helper.column_index("schema_test", "C"), 2);
+    CHECK_EQ(db_helper.column_index("schema_test", "d"), -1);
+
+    auto index = std::find_if(schema->indexes.begin(), schema->indexes.end(),
+                              [](const DBHelper::index_schema &i) { return i.name == "schema_test_c"; });
+    REQUIRE(index != schema->indexes.end());
+    CHECK(index->unique);
+    CHECK_EQ(index->origin, "c");
+    CHECK_EQ(index->columns, std::vector<std::string>{"c", "a"});
+
+    SUBCASE("lookups are served from the cache until the schema changes") {
+        CHECK_EQ(db_helper.get_schema("SCHEMA_TEST"), schema);
+        CHECK(db_helper.table_exists("schema_test"));
+        CHECK_FALSE(db_helper.table_exists("schema_test_2"));
+
+        db_helper.execute("ALTER TABLE schema_test ADD COLUMN d TEXT")->exec();
+        CHECK_NE(db_helper.get_schema("schema_test"), schema);
+        CHECK_EQ(db_helper.column_index("schema_test", "d"), 3);
+
+        db_helper.execute("CREATE TABLE schema_test_2 (id INTEGER)")->exec();
+        CHECK(db_helper.table_exists("schema_test_2"));
+        db_helper.drop("schema_test_2");
+        CHECK_FALSE(db_helper.table_exists("schema_test_2"));
+        CHECK_FALSE(db_helper.get_schema("schema_test_2"));
+    }
+
+    SUBCASE("changes of other connections") {
+        DBHelper other(db_helper.get_db_full_path(), SQLite::OPEN_READWRITE | SQLite::OPEN_NOMUTEX);
+        other.drop("schema_test");
+        CHECK_FALSE(db_helper.table_exists("schema_test"));
+        CHECK_FALSE(db_helper.get_schema("schema_test"));
+    }
+
+    SUBCASE("rolled back changes") {
+        {
+            DBHelper::Transaction transaction(db_helper);
+            db_helper.execute("CREATE TABLE schema_test_2 (id INTEGER)")->exec();
+            CHECK(db_helper.table_exists("schema_test_2"));
+        }
+        //  the version is back to the one before the transaction, the next change brings back the one inside it
+        db_helper.execute("CREATE TABLE schema_test_3 (id INTEGER)")->exec();
+        CHECK_FALSE(db_helper.table_exists("schema_test_2"));
+        CHECK(db_helper.table_exists("schema_test_3"));
+
+        {
+            DBHelper::Savepoint savepoint(db_helper);
+            db_helper.drop("schema_test_3");
+            CHECK_FALSE(db_helper.table_exists("schema_test_3"));
+        }
+        CHECK(db_helper.table_exists("schema_test_3"));
+        db_helper.drop("schema_test_3");
+    }
+
+    db_helper.drop("schema_test");
+}
+
+TEST_CASE("backup") {
+    DBHelper db_helper;
+    db_helper.drop("backup_test");
+    db_helper.create("backup_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    std::vector<std::tuple<int, std::string>> rows;
+    for (int i = 0; i < 2000; ++i)
+        rows.emplace_back(i, std::string(100, 'a' + i % 26));
+    db_helper.insert_many("backup_test", {"id", "name"}, rows);
+
+    const std::string path = db_helper.get_db_dir_path() + "backup.db3";
+    std::remove(path.c_str());
+
+    SUBCASE("step by step") {
+        std::vector<DBHelper::backup_progress> steps;
+        std::future<bool> done = db_helper.backup_to(path, 8, std::chrono::milliseconds(1),
+                                                     [&](const DBHelper::backup_progress &progress) {
+                                                         steps.push_back(progress);
+                                                         return true;
+                                                     });
+        REQUIRE(done.get());
+        CHECK_GT(steps.size(), 1);
+        CHECK_EQ(steps.back().remaining_pages, 0);
+        CHECK_EQ(steps.back().fraction(), 1);
+
+        DBHelper copy(path, SQLite::OPEN_READONLY | SQLite::OPEN_NOMUTEX);
+        CHECK_EQ(copy.row_count("backup_test"), 2000);
+        CHECK_EQ(copy.try_get<std::string>("backup_test", "name", "id", 27), std::string(100, 'b'));
+    }
+
+    SUBCASE("writes during the backup") {
+        std::future<bool> done = db_helper.backup_to(path, 4, std::chrono::milliseconds(1));
+        for (int i = 2000; i < 2050; ++i) {
+            db_helper.insert("backup_test", "id", "name", i, "late");
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        REQUIRE(done.get());
+
+        DBHelper copy(path, SQLite::OPEN_READONLY | SQLite::OPEN_NOMUTEX);
+        long long count = copy.row_count("backup_test");
+        CHECK_GE(count, 2000);
+        CHECK_LE(count, 2050);
+        std::shared_ptr<SQLite::Statement> check = copy.execute("PRAGMA integrity_check");
+        REQUIRE(check->executeStep());
+        CHECK_EQ(check->getColumn(0).getString(), "ok");
+    }
+
+    SUBCASE("cancelled") {
+        std::future<bool> done = db_helper.backup_to(path, 1, std::chrono::milliseconds(0),
+                                                     [](const DBHelper::backup_progress &) { return false; });
+        CHECK_FALSE(done.get());
+    }
+
+    SUBCASE("a destination that stays locked") {
+        SQLite::Database holder(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_NOMUTEX);
+        holder.exec("BEGIN EXCLUSIVE");
+        std::future<bool> done = db_helper.backup_to(path, 8, std::chrono::milliseconds(1));
+        REQUIRE_EQ(done.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+        CHECK_FALSE(done.get());
+        holder.exec("ROLLBACK");
+    }
+
+    SUBCASE("snapshot_to_memory") {
+        std::unique_ptr<DBHelper> snapshot = db_helper.snapshot_to_memory();
+        REQUIRE(snapshot);
+        CHECK_EQ(snapshot->get_db_full_path(), ":memory:");
+        CHECK_EQ(snapshot->row_count("backup_test"), 2000);
+
+        snapshot->dele("backup_test", "id", 1);
+        CHECK_EQ(snapshot->row_count("backup_test"), 1999);
+        CHECK_EQ(db_helper.row_count("backup_test"), 2000);
+
+        std::future<bool> done = snapshot->backup_to(path);
+        REQUIRE(done.get());
+        CHECK_EQ(DBHelper(path, SQLite::OPEN_READONLY | SQLite::OPEN_NOMUTEX).row_count("backup_test"), 1999);
+    }
+
+    std::remove(path.c_str());
+    db_helper.drop("backup_test");
+}
+
+TEST_CASE("in memory databases") {
+    DBHelper db_helper;
+    const std::string fixture = db_helper.get_db_dir_path() + "fixture.db3";
+    const std::string saved = db_helper.get_db_dir_path() + "saved.db3";
+    std::remove(fixture.c_str());
+    std::remove(saved.c_str());
+
+    //  kept open in WAL mode, so the rows are still in the -wal file when the fixture is loaded
+    DBHelper file(fixture, DBHelper::options::of(DBHelper::BALANCED));
+    file.create("memory_test", "id", DBHelper::INTEGER, DBHelper::PRIMARY_KEY, "name", DBHelper::TEXT);
+    std::vector<std::tuple<int, std::string>> rows;
+    for (int i = 0; i < 500; ++i)
+        rows.emplace_back(i, "name" + std::to_string(i));
+    file.insert_many("memory_test", {"id", "name"}, rows);
+
+    SUBCASE(":memory:") {
+        DBHelper memory(":memory:");
+        CHECK(memory.is_in_memory());
+        CHECK_FALSE(db_helper.is_in_memory());
+        CHECK_FALSE(memory.table_exists("memory_test"));
+
+        REQUIRE(memory.load_from_file(fixture));
+        CHECK(memory.table_exists("memory_test"));
+        CHECK_EQ(memory.row_count("memory_test"), 500);
+        CHECK_FALSE(memory.insert("memory_test", "id", "name", 500, "in memory").empty());
+        CHECK_EQ(file.row_count("memory_test"), 500);
+
+        REQUIRE(memory.save_to_file(saved));
+        CHECK_EQ(DBHelper(saved, SQLite::OPEN_READONLY | SQLite::OPEN_NOMUTEX).row_count("memory_test"), 501);
+
+        //  loading again throws away what was written since
+        REQUIRE(memory.load_from_file(saved));
+        REQUIRE(memory.load_from_file(fixture));
+        CHECK_EQ(memory.row_count("memory_test"), 500);
+    }
+
+    SUBCASE("shared cache URI") {
+        DBHelper first("file:dbhelper_memory_test?mode=memory&cache=shared");
+        DBHelper second("file:dbhelper_memory_test?mode=memory&cache=shared");
+        CHECK(first.is_in_memory());
+        CHECK_NE(first.db().getHandle(), second.db().getHandle());
+
+        REQUIRE(first.load_from_file(fixture));
+        CHECK_EQ(second.row_count("memory_test"), 500);
+    }
+
+    SUBCASE("failed loads keep the database") {
+        DBHelper memory(":memory:");
+        REQUIRE(memory.load_from_file(fixture));
+        CHECK_FALSE(memory.load_from_file(fixture + ".missing"));
+        {
+            DBHelper::Transaction transaction(memory);
+            CHECK_FALSE(memory.load_from_file(fixture));
+        }
+        CHECK_EQ(memory.row_count("memory_test"), 500);
+    }
+
+    std::remove(saved.c_str());
+}
+
 /*
 TEST_CASE(R"()") {
 